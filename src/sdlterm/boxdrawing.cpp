@@ -0,0 +1,403 @@
+#include "boxdrawing.h"
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace {
+
+enum Weight { None = 0, Light = 1, Heavy = 2, Double = 3 };
+
+// arms of U+2500-U+257F as weights of up, right, down, left
+const char *const LINES[0x80] = {
+    "0101", "0202", "1010", "2020", "0101", "0202", "1010", "2020", // 2500
+    "0101", "0202", "1010", "2020", "0110", "0210", "0120", "0220", // 2508
+    "0011", "0012", "0021", "0022", "1100", "1200", "2100", "2200", // 2510
+    "1001", "1002", "2001", "2002", "1110", "1210", "2110", "1120", // 2518
+    "2120", "2210", "1220", "2220", "1011", "1012", "2011", "1021", // 2520
+    "2021", "2012", "1022", "2022", "0111", "0112", "0211", "0212", // 2528
+    "0121", "0122", "0221", "0222", "1101", "1102", "1201", "1202", // 2530
+    "2101", "2102", "2201", "2202", "1111", "1112", "1211", "1212", // 2538
+    "2111", "1121", "2121", "2112", "2211", "1122", "1221", "2212", // 2540
+    "1222", "2122", "2221", "2222", "0101", "0202", "1010", "2020", // 2548
+    "0303", "3030", "0310", "0130", "0330", "0013", "0031", "0033", // 2550
+    "1300", "3100", "3300", "1003", "3001", "3003", "1310", "3130", // 2558
+    "3330", "1013", "3031", "3033", "0313", "0131", "0333", "1303", // 2560
+    "3101", "3303", "1313", "3131", "3333", "0110", "0011", "1001", // 2568
+    "1100", "0000", "0000", "0000", "0001", "1000", "0100", "0010", // 2570
+    "0002", "2000", "0200", "0020", "0201", "1020", "0102", "2010", // 2578
+};
+
+// segments of the dashed lines, 0 for solid ones
+int DashCount(char32_t ch) {
+  if (ch >= 0x2504 && ch <= 0x2507) {
+    return 3;
+  }
+  if (ch >= 0x2508 && ch <= 0x250B) {
+    return 4;
+  }
+  if (ch >= 0x254C && ch <= 0x254F) {
+    return 2;
+  }
+  return 0;
+}
+
+// quadrants of U+2596-U+259F
+enum Quadrant { UL = 1, UR = 2, LL = 4, LR = 8 };
+const int QUADRANTS[10] = {
+    LL, LR, UL, UL | LL | LR, UL | LR, UL | UR | LL, UL | UR | LR,
+    UR, UR | LL, UR | LL | LR,
+};
+
+struct Canvas {
+  int w;
+  int h;
+  Uint8 *alpha;
+
+  void Fill(int x0, int y0, int x1, int y1, Uint8 value = 255) {
+    x0 = std::max(x0, 0);
+    y0 = std::max(y0, 0);
+    x1 = std::min(x1, w);
+    y1 = std::min(y1, h);
+    for (int y = y0; y < y1; ++y) {
+      for (int x = x0; x < x1; ++x) {
+        alpha[y * w + x] = value;
+      }
+    }
+  }
+
+  void Blend(int x, int y, float coverage) {
+    if (x < 0 || y < 0 || x >= w || y >= h || coverage <= 0) {
+      return;
+    }
+    auto value = (Uint8)(std::min(coverage, 1.0f) * 255);
+    alpha[y * w + x] = std::max(alpha[y * w + x], value);
+  }
+};
+
+// Line geometry shared by every glyph of a cell size, so that strokes of
+// neighbouring cells meet exactly.
+struct Strokes {
+  int cx;     // center column
+  int cy;     // center row
+  int light;  // light stroke thickness
+  int heavy;  // heavy stroke thickness
+  int offset; // distance of a double line from the center
+
+  Strokes(int w, int h)
+      : cx(w / 2), cy(h / 2), light(std::max(1, (w + 4) / 9)),
+        heavy(light * 2 + 1), offset(light) {}
+
+  int Thickness(int weight) const {
+    return weight == Heavy ? heavy : light;
+  }
+
+  // pixels [min, max) covered across the stroke axis around center c
+  void Span(int c, int weight, int *min, int *max) const {
+    if (weight == None) {
+      *min = *max = c;
+    } else if (weight == Double) {
+      *min = c - offset - light / 2;
+      *max = c + offset - light / 2 + light;
+    } else {
+      int t = Thickness(weight);
+      *min = c - t / 2;
+      *max = *min + t;
+    }
+  }
+};
+
+int Wider(const Strokes &s, int a, int b) {
+  int amin, amax, bmin, bmax;
+  s.Span(0, a, &amin, &amax);
+  s.Span(0, b, &bmin, &bmax);
+  return (amax - amin) >= (bmax - bmin) ? a : b;
+}
+
+void DrawLines(Canvas &c, const char *arms) {
+  Strokes s(c.w, c.h);
+  int up = arms[0] - '0';
+  int right = arms[1] - '0';
+  int down = arms[2] - '0';
+  int left = arms[3] - '0';
+
+  // what the horizontal arms have to join at the center, and vice versa
+  int vmin, vmax, hmin, hmax;
+  s.Span(s.cx, Wider(s, up, down), &vmin, &vmax);
+  s.Span(s.cy, Wider(s, left, right), &hmin, &hmax);
+
+  auto horizontal = [&](int weight, bool to_right) {
+    if (weight == None) {
+      return;
+    }
+    if (weight != Double) {
+      int t = s.Thickness(weight);
+      int y = s.cy - t / 2;
+      if (to_right) {
+        c.Fill(vmin, y, c.w, y + t);
+      } else {
+        c.Fill(0, y, vmax, y + t);
+      }
+      return;
+    }
+    // each line runs up to the outer side of the vertical lines, unless
+    // an arm on its own side is in the way
+    for (int side : {-1, 1}) {
+      int y = s.cy + side * s.offset - s.light / 2;
+      bool blocked = side < 0 ? up != None : down != None;
+      if (to_right) {
+        c.Fill(blocked ? vmax - (up == Double || down == Double ? s.light : 0)
+                       : vmin,
+               y, c.w, y + s.light);
+      } else {
+        c.Fill(0, y,
+               blocked ? vmin + (up == Double || down == Double ? s.light : 0)
+                       : vmax,
+               y + s.light);
+      }
+    }
+  };
+
+  auto vertical = [&](int weight, bool to_bottom) {
+    if (weight == None) {
+      return;
+    }
+    if (weight != Double) {
+      int t = s.Thickness(weight);
+      int x = s.cx - t / 2;
+      if (to_bottom) {
+        c.Fill(x, hmin, x + t, c.h);
+      } else {
+        c.Fill(x, 0, x + t, hmax);
+      }
+      return;
+    }
+    for (int side : {-1, 1}) {
+      int x = s.cx + side * s.offset - s.light / 2;
+      bool blocked = side < 0 ? left != None : right != None;
+      if (to_bottom) {
+        c.Fill(x,
+               blocked ? hmax - (left == Double || right == Double ? s.light
+                                                                    : 0)
+                       : hmin,
+               x + s.light, c.h);
+      } else {
+        c.Fill(x, 0, x + s.light,
+               blocked ? hmin + (left == Double || right == Double ? s.light
+                                                                    : 0)
+                       : hmax);
+      }
+    }
+  };
+
+  horizontal(right, true);
+  horizontal(left, false);
+  vertical(down, true);
+  vertical(up, false);
+}
+
+void DrawDashes(Canvas &c, const char *arms, int count) {
+  Strokes s(c.w, c.h);
+  bool is_horizontal = arms[1] != '0';
+  int t = s.Thickness((is_horizontal ? arms[1] : arms[0]) - '0');
+  int length = is_horizontal ? c.w : c.h;
+  int gap = std::max(1, length / (count * 3));
+  for (int i = 0; i < count; ++i) {
+    int start = i * length / count + gap / 2;
+    int end = (i + 1) * length / count - (gap - gap / 2);
+    if (is_horizontal) {
+      c.Fill(start, s.cy - t / 2, end, s.cy - t / 2 + t);
+    } else {
+      c.Fill(s.cx - t / 2, start, s.cx - t / 2 + t, end);
+    }
+  }
+}
+
+// rounded corner joining the arm towards dx with the arm towards dy
+void DrawArc(Canvas &c, int dx, int dy) {
+  Strokes s(c.w, c.h);
+  int t = s.light;
+  // centers of the straight strokes this arc joins
+  float lx = s.cx - t / 2 + t / 2.0f;
+  float ly = s.cy - t / 2 + t / 2.0f;
+  float r = std::min(dx > 0 ? c.w - lx : lx, dy > 0 ? c.h - ly : ly);
+  float ax = lx + dx * r;
+  float ay = ly + dy * r;
+
+  for (int y = 0; y < c.h; ++y) {
+    for (int x = 0; x < c.w; ++x) {
+      float px = x + 0.5f;
+      float py = y + 0.5f;
+      if ((px - lx) * dx < -t || (py - ly) * dy < -t || (px - ax) * dx > 0 ||
+          (py - ay) * dy > 0) {
+        continue;
+      }
+      float d = std::hypot(px - ax, py - ay);
+      c.Blend(x, y, t / 2.0f + 0.5f - std::fabs(d - r));
+    }
+  }
+
+  // straight parts from the ends of the arc to the cell edges
+  int ex = (int)std::lround(ax);
+  int ey = (int)std::lround(ay);
+  int x = s.cx - t / 2;
+  int y = s.cy - t / 2;
+  if (dx > 0) {
+    c.Fill(ex, y, c.w, y + t);
+  } else {
+    c.Fill(0, y, ex, y + t);
+  }
+  if (dy > 0) {
+    c.Fill(x, ey, x + t, c.h);
+  } else {
+    c.Fill(x, 0, x + t, ey);
+  }
+}
+
+// line through the cell corners (x0, 0) and (x1, h)
+void DrawDiagonal(Canvas &c, float x0, float x1) {
+  Strokes s(c.w, c.h);
+  float dx = x1 - x0;
+  float dy = (float)c.h;
+  float length = std::hypot(dx, dy);
+  for (int y = 0; y < c.h; ++y) {
+    for (int x = 0; x < c.w; ++x) {
+      float px = x + 0.5f - x0;
+      float py = y + 0.5f;
+      float d = std::fabs(px * dy - py * dx) / length;
+      c.Blend(x, y, s.light / 2.0f + 0.5f - d);
+    }
+  }
+}
+
+void DrawBlock(Canvas &c, char32_t ch) {
+  auto eighths = [](int length, int n) {
+    return (int)std::lround(length * n / 8.0);
+  };
+  int hx = c.w / 2;
+  int hy = c.h / 2;
+
+  if (ch == 0x2580) {
+    c.Fill(0, 0, c.w, hy);
+  } else if (ch >= 0x2581 && ch <= 0x2588) {
+    c.Fill(0, c.h - eighths(c.h, ch - 0x2580), c.w, c.h);
+  } else if (ch >= 0x2589 && ch <= 0x258F) {
+    c.Fill(0, 0, eighths(c.w, 0x2590 - ch), c.h);
+  } else if (ch == 0x2590) {
+    c.Fill(hx, 0, c.w, c.h);
+  } else if (ch >= 0x2591 && ch <= 0x2593) {
+    // shades as uniform coverage, so they tile without dither seams
+    c.Fill(0, 0, c.w, c.h, (Uint8)(64 * (ch - 0x2590)));
+  } else if (ch == 0x2594) {
+    c.Fill(0, 0, c.w, eighths(c.h, 1));
+  } else if (ch == 0x2595) {
+    c.Fill(c.w - eighths(c.w, 1), 0, c.w, c.h);
+  } else if (ch >= 0x2596) {
+    int quadrants = QUADRANTS[ch - 0x2596];
+    if (quadrants & UL) {
+      c.Fill(0, 0, hx, hy);
+    }
+    if (quadrants & UR) {
+      c.Fill(hx, 0, c.w, hy);
+    }
+    if (quadrants & LL) {
+      c.Fill(0, hy, hx, c.h);
+    }
+    if (quadrants & LR) {
+      c.Fill(hx, hy, c.w, c.h);
+    }
+  }
+}
+
+} // namespace
+
+void BoxSprites::Rasterize(char32_t ch, int w, int h, Uint8 *alpha) {
+  Canvas c{w, h, alpha};
+  c.Fill(0, 0, w, h, 0);
+  if (!Contains(ch)) {
+    return;
+  }
+
+  if (ch >= 0x2580) {
+    DrawBlock(c, ch);
+  } else if (ch >= 0x256D && ch <= 0x2570) {
+    static const int ARCS[4][2] = {{1, 1}, {-1, 1}, {-1, -1}, {1, -1}};
+    DrawArc(c, ARCS[ch - 0x256D][0], ARCS[ch - 0x256D][1]);
+  } else if (ch >= 0x2571 && ch <= 0x2573) {
+    if (ch != 0x2572) {
+      DrawDiagonal(c, (float)w, 0);
+    }
+    if (ch != 0x2571) {
+      DrawDiagonal(c, 0, (float)w);
+    }
+  } else if (auto count = DashCount(ch)) {
+    DrawDashes(c, LINES[ch - First], count);
+  } else {
+    DrawLines(c, LINES[ch - First]);
+  }
+}
+
+BoxSprites::~BoxSprites() { Release(); }
+
+void BoxSprites::Release() {
+  if (atlas_) {
+    SDL_DestroyTexture(atlas_);
+    atlas_ = nullptr;
+  }
+  cell_width_ = 0;
+  cell_height_ = 0;
+}
+
+bool BoxSprites::Build(SDL_Renderer *renderer, int cell_width,
+                       int cell_height) {
+  if (atlas_ && cell_width == cell_width_ && cell_height == cell_height_) {
+    return true;
+  }
+  Release();
+  if (cell_width <= 0 || cell_height <= 0) {
+    return false;
+  }
+
+  constexpr int count = Last - First + 1;
+  constexpr int rows = (count + Columns - 1) / Columns;
+  int width = cell_width * Columns;
+  int height = cell_height * rows;
+
+  std::vector<Uint8> alpha(cell_width * cell_height);
+  std::vector<Uint8> pixels(width * height * 4);
+  for (int i = 0; i < count; ++i) {
+    Rasterize(First + i, cell_width, cell_height, alpha.data());
+    int x0 = (i % Columns) * cell_width;
+    int y0 = (i / Columns) * cell_height;
+    for (int y = 0; y < cell_height; ++y) {
+      // RGBA32 is byte order R, G, B, A
+      auto dst = &pixels[((y0 + y) * width + x0) * 4];
+      for (int x = 0; x < cell_width; ++x, dst += 4) {
+        dst[0] = dst[1] = dst[2] = 255;
+        dst[3] = alpha[y * cell_width + x];
+      }
+    }
+  }
+
+  atlas_ = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA32,
+                             SDL_TEXTUREACCESS_STATIC, width, height);
+  if (!atlas_) {
+    return false;
+  }
+  SDL_UpdateTexture(atlas_, nullptr, pixels.data(), width * 4);
+  SDL_SetTextureBlendMode(atlas_, SDL_BLENDMODE_BLEND);
+  cell_width_ = cell_width;
+  cell_height_ = cell_height;
+  return true;
+}
+
+void BoxSprites::Render(SDL_Renderer *renderer, char32_t ch,
+                        const SDL_Rect &dst, SDL_Color color) {
+  if (!atlas_ || !Contains(ch)) {
+    return;
+  }
+  int i = ch - First;
+  SDL_Rect src = {(i % Columns) * cell_width_, (i / Columns) * cell_height_,
+                  cell_width_, cell_height_};
+  SDL_SetTextureColorMod(atlas_, color.r, color.g, color.b);
+  SDL_RenderCopy(renderer, atlas_, &src, &dst);
+}
@@ -0,0 +1,35 @@
+#pragma once
+#include <SDL.h>
+
+// Box drawing (U+2500-U+257F) and block element (U+2580-U+259F) glyphs
+// drawn procedurally at the exact cell size. Lines run edge to edge so
+// they join seamlessly with the neighbouring cells, and no font lookup is
+// involved. All sprites live in one atlas texture built per cell size.
+class BoxSprites {
+  SDL_Texture *atlas_ = nullptr;
+  int cell_width_ = 0;
+  int cell_height_ = 0;
+
+public:
+  static constexpr char32_t First = 0x2500;
+  static constexpr char32_t Last = 0x259F;
+  static constexpr int Columns = 16;
+
+  BoxSprites() = default;
+  BoxSprites(const BoxSprites &) = delete;
+  BoxSprites &operator=(const BoxSprites &) = delete;
+  ~BoxSprites();
+
+  // destroys the atlas, call before its renderer is destroyed
+  void Release();
+
+  static bool Contains(char32_t ch) { return ch >= First && ch <= Last; }
+
+  // (re)builds the atlas, call whenever the cell size changes
+  bool Build(SDL_Renderer *renderer, int cell_width, int cell_height);
+  // draws ch into the cell rect dst, tinted with color
+  void Render(SDL_Renderer *renderer, char32_t ch, const SDL_Rect &dst,
+              SDL_Color color);
+  // rasterizes the coverage of ch into alpha (w * h bytes, pitch w)
+  static void Rasterize(char32_t ch, int w, int h, Uint8 *alpha);
+};
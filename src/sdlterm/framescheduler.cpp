@@ -0,0 +1,50 @@
+#include "framescheduler.h"
+#include <algorithm>
+
+void FrameScheduler::SetRefreshRate(int hz) {
+  if (hz <= 0) {
+    hz = 60;
+  }
+  interval_ = std::chrono::duration_cast<Clock::duration>(
+      std::chrono::duration<double>(1.0 / hz));
+}
+
+FrameScheduler::Clock::time_point FrameScheduler::NextFrame() const {
+  if (vsync_) {
+    // the present blocks until the refresh, ask for the frame early so
+    // the wait is not missed by a hair and the rate halved
+    return last_present_ + interval_ / 2;
+  }
+  return last_present_ + interval_;
+}
+
+bool FrameScheduler::ParseTimeLeft(Clock::time_point now) const {
+  // stop in time to render before the refresh after the next frame is due
+  auto margin = std::chrono::milliseconds(1);
+  return now + render_cost_ + margin < last_present_ + interval_;
+}
+
+bool FrameScheduler::ShouldRender(bool dirty, Clock::time_point now) const {
+  return dirty && now >= NextFrame();
+}
+
+void FrameScheduler::Presented(Clock::duration render_time,
+                               Clock::time_point now) {
+  last_present_ = now;
+  // smoothed, a single slow frame should not starve the parser
+  render_cost_ = (render_cost_ * 3 + render_time) / 4;
+}
+
+int FrameScheduler::WaitMs(bool dirty, Clock::time_point now,
+                           Clock::time_point until) const {
+  auto wait = now - last_activity_ < ActiveTime
+                  ? Clock::duration(ActiveWait)
+                  : Clock::duration(IdleWait);
+  if (dirty) {
+    wait = std::min(wait, NextFrame() - now);
+  } else {
+    wait = std::min(wait, until - now);
+  }
+  auto ms = std::chrono::ceil<std::chrono::milliseconds>(wait).count();
+  return (int)std::max<decltype(ms)>(ms, 0);
+}
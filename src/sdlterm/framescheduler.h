@@ -0,0 +1,45 @@
+#pragma once
+#include <chrono>
+
+// Paces the main loop to the display. A frame is presented at most once
+// per refresh and only when something changed; idle, nothing is presented
+// and the loop sleeps in the pty wait. Under sustained output the loop
+// parses until just before the next frame is due, leaving room for the
+// render, so parsing and rendering share each refresh interval.
+class FrameScheduler {
+public:
+  using Clock = std::chrono::steady_clock;
+
+  // how late window events may be seen while the loop sleeps on the pty,
+  // short right after input or output so typing stays responsive
+  static constexpr std::chrono::milliseconds ActiveWait{2};
+  static constexpr std::chrono::milliseconds IdleWait{10};
+  static constexpr std::chrono::milliseconds ActiveTime{500};
+
+  FrameScheduler() { SetRefreshRate(0); }
+
+  // 0 if unknown, 60 Hz is assumed
+  void SetRefreshRate(int hz);
+  // with vsync the present itself waits for the refresh
+  void SetVsync(bool vsync) { vsync_ = vsync; }
+  // input was sent or output parsed
+  void Activity(Clock::time_point now) { last_activity_ = now; }
+
+  // parse more output before rendering?
+  bool ParseTimeLeft(Clock::time_point now) const;
+  bool ShouldRender(bool dirty, Clock::time_point now) const;
+  // render_time excludes the present, which may wait for the refresh
+  void Presented(Clock::duration render_time, Clock::time_point now);
+  // how long to wait for child output before the next iteration, until is
+  // the renderer's next timed change (cursor blink)
+  int WaitMs(bool dirty, Clock::time_point now, Clock::time_point until) const;
+
+private:
+  Clock::duration interval_{};
+  bool vsync_ = false;
+  Clock::time_point last_present_;
+  Clock::duration render_cost_{};
+  Clock::time_point last_activity_;
+
+  Clock::time_point NextFrame() const;
+};
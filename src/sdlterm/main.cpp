@@ -1,10 +1,19 @@
 #include "SDL_fox.h"
+#include "framescheduler.h"
+#include "paste.h"
+#include "replay.h"
 #include "sdlrenderer.h"
 #include "term_config.h"
+#include <chrono>
 #include <iostream>
 // #include <SDL_fox.h>
 #include <childprocess.h>
+#include <latency.h>
+#include <stdexcept>
+#include <stdio.h>
+#include <recorder.h>
 #include <sdl_app.h>
+#include <trace.h>
 #include <vterm_object.h>
 
 int main(int argc, char *argv[]) {
@@ -12,6 +21,9 @@ int main(int argc, char *argv[]) {
   if (cfg.ParseArgs(argc, argv)) {
     return 1;
   }
+  if (cfg.replay) {
+    return RunReplay(cfg);
+  }
 
   termtk::SDLApp app;
   auto window = app.CreateWindow(640, 480, PROGNAME);
@@ -25,38 +37,141 @@ int main(int argc, char *argv[]) {
   if (!renderer) {
     return 3;
   }
-  if (!renderer->LoadFont(cfg.font, cfg.fontsize, cfg.boldfont)) {
+  if (!renderer->LoadFont(cfg.font, cfg.fontsize,
+                          cfg.synthetic_bold ? nullptr : cfg.boldfont)) {
     return 4;
   }
+  for (int i = 0; i < cfg.nFallbackFonts; ++i) {
+    if (!renderer->AddFallbackFont(cfg.fallbackfonts[i])) {
+      std::cout << "fail to load fallback font: " << cfg.fallbackfonts[i]
+                << std::endl;
+    }
+  }
   int font_width = renderer->font_metrics->max_advance;
   int font_height = renderer->font_metrics->height;
   int rows = window->Height() / font_height;
   int cols = window->Width() / font_width;
 
   // child
-  termtk::ChildProcess child;
-  child.Launch(rows, cols, cfg.exec);
+  auto child_process = std::make_unique<termtk::ChildProcess>();
+  try {
+    child_process->Launch(rows, cols, cfg.exec);
+  } catch (const std::exception &e) {
+    // no pty; a program that fails to start just exits with 127
+    std::cout << "fail to launch: " << cfg.exec << " => " << e.what()
+              << std::endl;
+    return 5;
+  }
+  auto &child = *child_process;
+
+  termtk::SessionRecorder recorder;
+  if (cfg.record && !recorder.Open(cfg.record, rows, cols)) {
+    std::cout << "fail to record to: " << cfg.record << std::endl;
+  }
 
   termtk::Terminal vterm(rows, cols, font_width, font_height,
                          &termtk::ChildProcess::Write, &child);
+  ClipboardPaste paste;
+
+  termtk::LatencyTracker latency;
+  bool show_latency = false;
+  if (cfg.latency_log && !latency.OpenLog(cfg.latency_log)) {
+    std::cout << "fail to open: " << cfg.latency_log << std::endl;
+  }
+
+  if (cfg.trace) {
+    TRACE_INSTALL(cfg.trace);
+  }
+
+  using Clock = std::chrono::steady_clock;
+  FrameScheduler scheduler;
+  scheduler.SetVsync(renderer->Vsync());
+  scheduler.SetRefreshRate(window->RefreshRate());
+  // how long the next pty read may wait, the loop sleeps there when idle
+  int wait_ms = 0;
 
   while (app.NewFrame()) {
+    TRACE_SCOPE("frame");
+    TRACE_POLL();
     if (child.IsClosed()) {
       break;
     }
 
-    {
-      auto input = child.Read();
-      if (!input.empty()) {
-        vterm.input_write(input.data(), input.size());
-        renderer->SetDirty();
+    // child output, until the next frame is due. Hidden, nothing is due,
+    // parse for up to an idle wait so window events are still seen
+    bool visible = window->Visible();
+    auto hidden_until = Clock::now() + FrameScheduler::IdleWait;
+    for (auto timeout = wait_ms;; timeout = 0) {
+      auto input = child.Read(timeout);
+      if (input.empty()) {
+        break;
+      }
+      latency.Mark(termtk::LatencyTracker::Echo);
+      recorder.Output(input);
+      auto parse_start = Clock::now();
+      vterm.input_write(input.data(), input.size());
+      auto parse_end = Clock::now();
+      std::chrono::duration<double, std::milli> parse_time =
+          parse_end - parse_start;
+      renderer->Profiler().AddParse(parse_time.count(), input.size());
+      latency.Mark(termtk::LatencyTracker::Parse);
+      renderer->SetDirty();
+      scheduler.Activity(parse_end);
+      if (visible ? !scheduler.ParseTimeLeft(parse_end)
+                  : parse_end >= hidden_until) {
+        break;
       }
     }
 
     // window input to child
     auto input = app.DequeueInput();
     if (!input.empty()) {
+      latency.Begin(app.InputTime());
       child.Write(input.data(), input.size());
+      latency.Mark(termtk::LatencyTracker::Write);
+      scheduler.Activity(Clock::now());
+    }
+
+    for (auto command : app.DequeueCommands()) {
+      switch (command) {
+      case termtk::AppCommand::Paste:
+        paste.Begin(vterm);
+        break;
+      case termtk::AppCommand::ToggleLatencyOverlay:
+        show_latency = !show_latency;
+        if (!show_latency) {
+          renderer->SetOverlay("");
+        }
+        break;
+      case termtk::AppCommand::ToggleProfiler:
+        renderer->ToggleProfiler();
+        break;
+      case termtk::AppCommand::RenderTargetsReset:
+        renderer->InvalidateRows();
+        renderer->SetDirty();
+        break;
+      }
+    }
+    if (show_latency) {
+      auto summary = latency.Summarize();
+      char text[256];
+      snprintf(text, sizeof(text),
+               "keypress to photon, %zu samples\n"
+               "p50 %6.2f ms  p99 %6.2f ms\n"
+               "write %5.2f  echo %5.2f\n"
+               "parse %5.2f  present %5.2f",
+               summary.samples, summary.p50, summary.p99,
+               summary.stage[termtk::LatencyTracker::Write],
+               summary.stage[termtk::LatencyTracker::Echo],
+               summary.stage[termtk::LatencyTracker::Parse],
+               summary.stage[termtk::LatencyTracker::Present]);
+      renderer->SetOverlay(text);
+    }
+
+    // clipboard to child, a chunk at a time
+    if (paste.Active()) {
+      renderer->SetProgress(paste.Pump(child, vterm) ? paste.Progress()
+                                                     : -1.0f);
     }
 
     // window size to rows & cols
@@ -67,26 +182,57 @@ int main(int argc, char *argv[]) {
       cols = new_cols;
       std::cout << "rows x cols: " << rows << " x " << cols << std::endl;
       vterm.set_rows_cols(rows, cols);
-      child.NotifyTermSize(rows, cols);
+      recorder.Resize(rows, cols);
+      child.NotifyTermSize(rows, cols,
+                           cols * renderer->font_metrics->max_advance,
+                           rows * renderer->font_metrics->height);
       renderer->SetDirty();
+      // the window may have moved to another display
+      scheduler.SetRefreshRate(window->RefreshRate());
     }
 
-    // render vterm
-    auto render_screen = renderer->BeginRender();
-    if (render_screen) {
-      for (int y = 0; y < rows; y++) {
-        for (int x = 0; x < cols; x++) {
-          VTermPos pos = {
-              .row = y,
-              .col = x,
-          };
-          if (auto cell = vterm.get_cell(pos)) {
-            renderer->RenderCell(pos, *cell);
-          }
-        }
+    // cells touched since the last frame, and the bell
+    {
+      bool ringing;
+      auto &damaged = vterm.new_frame(&ringing);
+      renderer->AddDamage(damaged);
+      renderer->Profiler().current.damaged_cells += (int)damaged.size();
+      if (ringing) {
+        renderer->SetBell();
+        renderer->SetDirty();
       }
     }
-    renderer->EndRender(render_screen, cfg.width, cfg.height);
+
+    // shown again, the rows changed while hidden are rendered in one frame
+    if (window->Exposed()) {
+      renderer->SetDirty();
+    }
+
+    // render vterm, at most once per refresh and only when it changed.
+    // Update advances the blink and the bell, once per iteration
+    auto now = Clock::now();
+    bool dirty = visible && renderer->Update();
+    if (!visible) {
+      // hidden or minimized: parse only, no blink or present to wait for
+      wait_ms = paste.Active() || child.QueuedBytes()
+                    ? 1
+                    : (int)FrameScheduler::IdleWait.count();
+    } else if (scheduler.ShouldRender(dirty, now)) {
+      auto render_screen = renderer->BeginRender();
+      renderer->RenderScreen(rows, cols, vterm);
+      auto render_time = Clock::now() - now;
+      renderer->EndRender(render_screen, cfg.width, cfg.height);
+      scheduler.Presented(render_time, Clock::now());
+      latency.Mark(termtk::LatencyTracker::Present);
+      wait_ms = 0;
+    } else if (paste.Active() || child.QueuedBytes()) {
+      // more to send, the pty wait would only delay it
+      wait_ms = 1;
+    } else {
+      wait_ms = scheduler.WaitMs(dirty, now,
+                                 now + std::chrono::milliseconds(
+                                           renderer->NextUpdate()));
+    }
   }
 
   FOX_Exit();
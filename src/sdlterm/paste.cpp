@@ -0,0 +1,73 @@
+#include "paste.h"
+#include <SDL.h>
+#include <string.h>
+
+ClipboardPaste::~ClipboardPaste() { Release(); }
+
+void ClipboardPaste::Release() {
+  if (text_) {
+    SDL_free(text_);
+    text_ = nullptr;
+  }
+  size_ = 0;
+  pos_ = 0;
+}
+
+bool ClipboardPaste::Begin(termtk::Terminal &vterm) {
+  if (Active()) {
+    return true;
+  }
+  text_ = SDL_GetClipboardText();
+  if (!text_) {
+    return false;
+  }
+  size_ = strlen(text_);
+  pos_ = 0;
+  if (size_ == 0) {
+    Release();
+    return false;
+  }
+  vterm.paste_start();
+  return true;
+}
+
+size_t ClipboardPaste::FillChunk(size_t *consumed) {
+  size_t len = 0;
+  size_t i = pos_;
+  for (; i < size_ && len < ChunkSize; ++i) {
+    char ch = text_[i];
+    if (ch == '\033') {
+      // an embedded end marker must not terminate the paste early
+      continue;
+    }
+    if (ch == '\n') {
+      if (i > 0 && text_[i - 1] == '\r') {
+        continue;
+      }
+      // the pty expects Enter, not line feed
+      ch = '\r';
+    }
+    chunk_[len++] = ch;
+  }
+  *consumed = i - pos_;
+  return len;
+}
+
+bool ClipboardPaste::Pump(termtk::ChildProcess &child,
+                          termtk::Terminal &vterm) {
+  if (!Active()) {
+    return false;
+  }
+  while (pos_ < size_) {
+    size_t consumed;
+    auto len = FillChunk(&consumed);
+    if (len && !child.TryWrite(chunk_, len)) {
+      // the child is behind, try again next frame
+      return true;
+    }
+    pos_ += consumed;
+  }
+  vterm.paste_end();
+  Release();
+  return false;
+}
@@ -0,0 +1,36 @@
+#pragma once
+#include <childprocess.h>
+#include <stddef.h>
+#include <vterm_object.h>
+
+// Streams the clipboard to the child a chunk at a time through the
+// non-blocking write queue, so a multi-MB paste neither blocks the UI nor
+// gets copied into one big staging buffer. The text is wrapped in
+// bracketed paste markers when the child asked for them.
+class ClipboardPaste {
+  static constexpr size_t ChunkSize = 4096;
+
+  char *text_ = nullptr;
+  size_t size_ = 0;
+  size_t pos_ = 0;
+  char chunk_[ChunkSize];
+
+public:
+  ClipboardPaste() = default;
+  ClipboardPaste(const ClipboardPaste &) = delete;
+  ClipboardPaste &operator=(const ClipboardPaste &) = delete;
+  ~ClipboardPaste();
+
+  bool Active() const { return text_ != nullptr; }
+  // 0 to 1
+  float Progress() const { return size_ ? (float)pos_ / size_ : 1.0f; }
+
+  // grabs the clipboard, false if there is nothing to paste
+  bool Begin(termtk::Terminal &vterm);
+  // sends what the child accepts without blocking, false once done
+  bool Pump(termtk::ChildProcess &child, termtk::Terminal &vterm);
+
+private:
+  size_t FillChunk(size_t *consumed);
+  void Release();
+};
@@ -0,0 +1,100 @@
+#include "profiler.h"
+#include <algorithm>
+#include <alloc_counter.h>
+#include <stdio.h>
+#include <string.h>
+
+void FrameProfiler::EndFrame() {
+  history_[next_] = current;
+  next_ = (next_ + 1) % History;
+  count_ = std::min(count_ + 1, History);
+  current = {};
+}
+
+static float Percent(Uint32 hits, Uint32 misses) {
+  auto total = hits + misses;
+  return total ? 100.0f * hits / total : 100.0f;
+}
+
+void FrameProfiler::Render(RenderList &list, const FOX_FontMetrics *metrics,
+                           int height) const {
+  Frame sum;
+  int frames = std::min(count_, Average);
+  for (int age = 0; age < frames; ++age) {
+    auto &frame = Get(age);
+    sum.parse_ms += frame.parse_ms;
+    sum.render_ms += frame.render_ms;
+    sum.present_ms += frame.present_ms;
+    sum.bytes += frame.bytes;
+    sum.draw_calls += frame.draw_calls;
+    sum.damaged_cells += frame.damaged_cells;
+    sum.glyph_hits += frame.glyph_hits;
+    sum.glyph_misses += frame.glyph_misses;
+    sum.row_hits += frame.row_hits;
+    sum.row_misses += frame.row_misses;
+    sum.allocations += frame.allocations;
+  }
+  float n = std::max(frames, 1);
+
+  char text[256];
+  snprintf(text, sizeof(text),
+           "parse   %6.2f ms %8.0f B\n"
+           "render  %6.2f ms %6.0f draws\n"
+           "present %6.2f ms %6.0f damaged\n"
+           "glyphs  %5.1f%%   rows %5.1f%%\n",
+           sum.parse_ms / n, sum.bytes / n, sum.render_ms / n,
+           sum.draw_calls / n, sum.present_ms / n, sum.damaged_cells / n,
+           Percent(sum.glyph_hits, sum.glyph_misses),
+           Percent(sum.row_hits, sum.row_misses));
+  auto used = strlen(text);
+  if (termtk::CountsAllocations) {
+    snprintf(text + used, sizeof(text) - used, "allocs  %6.1f per frame",
+             sum.allocations / n);
+  } else {
+    snprintf(text + used, sizeof(text) - used, "allocs  not counted");
+  }
+
+  // 2 pixels per frame, 3 pixels per millisecond, 50 ms fill the graph
+  const int pad = 4;
+  const int bar = 2;
+  const float scale = 3.0f;
+  const int graph_height = 150;
+  const int lines = 5;
+  const int columns = 32;
+  SDL_Rect box = {0, 0,
+                  std::max(History * bar, columns * metrics->max_advance) +
+                      pad * 2,
+                  lines * metrics->height + graph_height + pad * 3};
+  box.y = height - box.h;
+  list.AddFill(box, {0, 0, 0, 192});
+
+  // newest frame on the right, parse, render and present stacked
+  int base = height - pad;
+  for (int age = 0; age < count_; ++age) {
+    auto &frame = Get(age);
+    SDL_Rect rect = {box.x + pad + (History - 1 - age) * bar, base, bar, 0};
+    struct {
+      float ms;
+      SDL_Color color;
+    } stages[] = {
+        {frame.parse_ms, {80, 160, 255, 255}},
+        {frame.render_ms, {80, 220, 120, 255}},
+        {frame.present_ms, {255, 170, 60, 255}},
+    };
+    for (auto &stage : stages) {
+      rect.h =
+          std::min((int)(stage.ms * scale), rect.y - (base - graph_height));
+      if (rect.h <= 0) {
+        continue;
+      }
+      rect.y -= rect.h;
+      list.AddFill(rect, stage.color);
+    }
+  }
+
+  // the 60 Hz frame budget
+  int budget = base - (int)(1000.0f / 60.0f * scale);
+  list.AddFill({box.x + pad, budget, History * bar, 1}, {255, 80, 80, 255});
+
+  list.AddText(box.x + pad, box.y + pad - 4, {255, 255, 160, 255}, text);
+}
@@ -0,0 +1,58 @@
+#pragma once
+#include "renderlist.h"
+#include <SDL.h>
+#include <SDL_fox.h>
+#include <cstddef>
+
+// Per frame timings and counters, drawn as a heads up display in the bottom
+// left corner (Ctrl+Shift+F11). The renderer fills in most of a frame, the
+// main loop adds what it spent parsing child output. Numbers are averaged
+// over the last Average frames, the graph shows the whole history.
+class FrameProfiler {
+public:
+  struct Frame {
+    float parse_ms = 0;
+    float render_ms = 0;
+    float present_ms = 0;
+    size_t bytes = 0;
+    int draw_calls = 0;
+    int damaged_cells = 0;
+    Uint32 glyph_hits = 0;
+    Uint32 glyph_misses = 0;
+    Uint32 row_hits = 0;
+    Uint32 row_misses = 0;
+    // operator new calls of the main thread since the previous frame
+    size_t allocations = 0;
+  };
+
+  static constexpr int History = 120;
+  static constexpr int Average = 30;
+
+  bool visible = false;
+  // the frame being measured
+  Frame current;
+
+  static double Milliseconds(Uint64 start, Uint64 end) {
+    return (double)(end - start) * 1000.0 / SDL_GetPerformanceFrequency();
+  }
+
+  void AddParse(double ms, size_t bytes) {
+    current.parse_ms += (float)ms;
+    current.bytes += bytes;
+  }
+  // moves the current frame into the history
+  void EndFrame();
+  // appends the HUD to the overlays of list, height is the output's
+  void Render(RenderList &list, const FOX_FontMetrics *metrics,
+              int height) const;
+
+private:
+  Frame history_[History];
+  // the slot the next frame goes to
+  int next_ = 0;
+  int count_ = 0;
+
+  const Frame &Get(int age) const {
+    return history_[(next_ - 1 - age + History) % History];
+  }
+};
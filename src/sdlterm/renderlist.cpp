@@ -0,0 +1,139 @@
+#include "renderlist.h"
+
+namespace {
+
+bool SameColor(const SDL_Color &a, const SDL_Color &b) {
+  return a.r == b.r && a.g == b.g && a.b == b.b && a.a == b.a;
+}
+
+} // namespace
+
+void RenderList::Clear() {
+  rows.clear();
+  runs.clear();
+  glyphs.clear();
+  decorations.clear();
+  ClearOverlays();
+}
+
+void RenderList::ClearOverlays() {
+  overlays.clear();
+  overlay_text.clear();
+}
+
+void RenderList::AddFill(const SDL_Rect &rect, SDL_Color color) {
+  overlays.push_back({Overlay::Fill, rect, color, 0});
+}
+
+void RenderList::AddFrame(const SDL_Rect &rect, SDL_Color color) {
+  overlays.push_back({Overlay::Frame, rect, color, 0});
+}
+
+void RenderList::AddText(int x, int y, SDL_Color color, const char *text) {
+  overlays.push_back(
+      {Overlay::Text, {x, y, 0, 0}, color, (uint32_t)overlay_text.size()});
+  // keeps the terminator, the backend draws straight from the buffer
+  overlay_text.append(text);
+  overlay_text += '\0';
+}
+
+void RenderList::AddRow(const termtk::Terminal &vterm, int row, int cols,
+                        uint64_t hash) {
+  BeginRow(row, hash);
+  for (int col = 0; col < cols; col++) {
+    // nullptr for the right half of wide characters
+    if (auto cell = vterm.get_cell({.row = row, .col = col})) {
+      AppendCell(col, *cell);
+    }
+  }
+  EndRow();
+}
+
+void RenderList::AddCell(int row, int col, const VTermScreenCell &cell) {
+  BeginRow(row, 0);
+  AppendCell(col, cell);
+  EndRow();
+}
+
+void RenderList::BeginRow(int row, uint64_t hash) {
+  auto runs_size = (uint32_t)runs.size();
+  auto glyphs_size = (uint32_t)glyphs.size();
+  auto decorations_size = (uint32_t)decorations.size();
+  rows.push_back({row, hash, runs_size, runs_size, glyphs_size, glyphs_size,
+                  decorations_size, decorations_size});
+  last_underline_ = -1;
+  last_strike_ = -1;
+}
+
+void RenderList::EndRow() {
+  auto &row = rows.back();
+  row.runs_end = (uint32_t)runs.size();
+  row.glyphs_end = (uint32_t)glyphs.size();
+  row.decorations_end = (uint32_t)decorations.size();
+}
+
+void RenderList::AppendCell(int col, const VTermScreenCell &cell) {
+  SDL_Color fg = {
+      .r = cell.fg.rgb.red,
+      .g = cell.fg.rgb.green,
+      .b = cell.fg.rgb.blue,
+      .a = 255,
+  };
+  SDL_Color bg = {
+      .r = cell.bg.rgb.red,
+      .g = cell.bg.rgb.green,
+      .b = cell.bg.rgb.blue,
+      .a = 255,
+  };
+  if (cell.attrs.reverse) {
+    fg.r = ~fg.r;
+    fg.g = ~fg.g;
+    fg.b = ~fg.b;
+    bg.r = ~bg.r;
+    bg.g = ~bg.g;
+    bg.b = ~bg.b;
+  }
+  int width = cell.width > 0 ? cell.width : 1;
+
+  // extend the previous run when the color continues
+  auto &row = rows.back();
+  if (runs.size() > row.runs_begin) {
+    auto &last = runs.back();
+    if (last.col + last.count == col && SameColor(last.color, bg)) {
+      last.count += width;
+    } else {
+      runs.push_back({col, width, bg});
+    }
+  } else {
+    runs.push_back({col, width, bg});
+  }
+
+  if (auto ch = cell.chars[0]) {
+    glyphs.push_back({col, ch, fg, (bool)cell.attrs.bold,
+                      (bool)cell.attrs.italic});
+  }
+
+  // underline and strike each extend their own run, a cell with both
+  // does not break either
+  auto decorate = [&](Decoration::Kind kind, int32_t &last) {
+    if (last >= 0) {
+      auto &prev = decorations[last];
+      if (prev.kind == kind && prev.col + prev.count == col &&
+          SameColor(prev.color, fg)) {
+        prev.count += width;
+        return;
+      }
+    }
+    last = (int32_t)decorations.size();
+    decorations.push_back({col, width, fg, kind});
+  };
+  // 1 single, 2 double, 3 curly, drawn single
+  if (cell.attrs.underline) {
+    decorate(cell.attrs.underline == 2 ? Decoration::DoubleUnderline
+                                       : Decoration::Underline,
+             last_underline_);
+  }
+  if (cell.attrs.strike) {
+    decorate(Decoration::Strike, last_strike_);
+  }
+}
@@ -0,0 +1,89 @@
+#pragma once
+#include <SDL_pixels.h>
+#include <SDL_rect.h>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <vterm.h>
+#include <vterm_object.h>
+
+// One frame of terminal drawing as plain data, in cell coordinates:
+// background runs, glyphs and decorations per row, then the overlays
+// drawn on top in pixels. Building it only reads
+// the Terminal, so it needs no renderer, can run on any thread and is
+// measured on its own; backends (the SDL renderer, offscreen) turn it into
+// draw calls. Rows carry the content hash, so a list built only from the
+// rows whose hash changed is the diff against the previous frame.
+class RenderList {
+public:
+  // cells sharing a background color
+  struct Run {
+    int col;
+    int count;
+    SDL_Color color;
+  };
+  struct Glyph {
+    int col;
+    char32_t ch;
+    SDL_Color color;
+    bool bold;
+    bool italic;
+  };
+  struct Decoration {
+    enum Kind : uint8_t { Underline, DoubleUnderline, Strike };
+    int col;
+    int count;
+    SDL_Color color;
+    Kind kind;
+  };
+  struct Row {
+    int row;
+    uint64_t hash;
+    // ranges into runs, glyphs and decorations
+    uint32_t runs_begin, runs_end;
+    uint32_t glyphs_begin, glyphs_end;
+    uint32_t decorations_begin, decorations_end;
+  };
+
+  // the cursor, the bell frame, the paste progress bar and the HUDs, in
+  // pixels and drawn in order over the rows
+  struct Overlay {
+    enum Kind : uint8_t { Fill, Frame, Text };
+    Kind kind;
+    // for Text only x and y, the pen position of the first line
+    SDL_Rect rect;
+    // blended when not opaque
+    SDL_Color color;
+    // Text: offset of the NUL terminated text in overlay_text
+    uint32_t text;
+  };
+
+  std::vector<Row> rows;
+  std::vector<Run> runs;
+  std::vector<Glyph> glyphs;
+  std::vector<Decoration> decorations;
+  std::vector<Overlay> overlays;
+  std::string overlay_text;
+
+  // keeps the capacity, a steady state frame does not allocate
+  void Clear();
+  void ClearOverlays();
+  void AddFill(const SDL_Rect &rect, SDL_Color color);
+  void AddFrame(const SDL_Rect &rect, SDL_Color color);
+  // may span lines separated by \n
+  void AddText(int x, int y, SDL_Color color, const char *text);
+  // appends row of vterm
+  void AddRow(const termtk::Terminal &vterm, int row, int cols,
+              uint64_t hash);
+  // appends a row holding a single cell
+  void AddCell(int row, int col, const VTermScreenCell &cell);
+
+private:
+  // index of the run each decoration kind may extend, -1 at row start
+  int32_t last_underline_ = -1;
+  int32_t last_strike_ = -1;
+
+  void BeginRow(int row, uint64_t hash);
+  void AppendCell(int col, const VTermScreenCell &cell);
+  void EndRow();
+};
@@ -0,0 +1,131 @@
+#include "replay.h"
+#include "sdlrenderer.h"
+#include <chrono>
+#include <iostream>
+#include <recording.h>
+#include <sdl_app.h>
+#include <string.h>
+#include <vterm_object.h>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+double Millis(Clock::duration d) {
+  return std::chrono::duration<double, std::milli>(d).count();
+}
+
+void PrintStage(const char *name, Clock::duration d, int frames) {
+  std::cout << "  " << name << ": " << Millis(d) << " ms";
+  if (frames) {
+    std::cout << " (" << Millis(d) / frames << " ms/frame)";
+  }
+  std::cout << std::endl;
+}
+
+} // namespace
+
+int RunReplay(const TERM_Config &cfg) {
+  termtk::Recording recording;
+  if (!recording.Load(cfg.replay)) {
+    std::cout << "fail to load: " << cfg.replay << std::endl;
+    return 5;
+  }
+  int rows = recording.rows;
+  int cols = recording.cols;
+
+  std::unique_ptr<termtk::SDLApp> app;
+  std::shared_ptr<termtk::SDLWindow> window;
+  std::shared_ptr<SDLRenderer> renderer;
+  bool offscreen = cfg.render && strcmp(cfg.render, "offscreen") == 0;
+  if (offscreen) {
+    SDL_Init(SDL_INIT_EVENTS);
+    renderer = SDLRenderer::CreateOffscreen(cfg.width, cfg.height);
+  } else if (cfg.render) {
+    SDL_SetHint(SDL_HINT_RENDER_DRIVER, cfg.render);
+    app = std::make_unique<termtk::SDLApp>();
+    window = app->CreateWindow(cfg.width, cfg.height, PROGNAME);
+    if (window) {
+      renderer = SDLRenderer::Create(window->Handle());
+    }
+  }
+  if (cfg.render && !renderer) {
+    std::cout << "fail to create renderer: " << cfg.render << std::endl;
+    return 3;
+  }
+
+  FOX_Init();
+  if (renderer) {
+    if (!renderer->LoadFont(cfg.font, cfg.fontsize,
+                            cfg.synthetic_bold ? nullptr : cfg.boldfont)) {
+      return 4;
+    }
+    for (int i = 0; i < cfg.nFallbackFonts; ++i) {
+      renderer->AddFallbackFont(cfg.fallbackfonts[i]);
+    }
+  }
+
+  // no child, terminal replies go nowhere
+  termtk::Terminal vterm(
+      rows, cols, 0, 0, [](const char *, size_t, void *) {}, nullptr);
+
+  Clock::duration parse{};
+  Clock::duration render{};
+  Clock::duration present{};
+  int frames = 0;
+  auto start = Clock::now();
+  for (auto &event : recording.events) {
+    if (event.kind == termtk::Recording::Event::Resize) {
+      rows = event.rows;
+      cols = event.cols;
+      vterm.set_rows_cols(rows, cols);
+      continue;
+    }
+
+    auto t0 = Clock::now();
+    vterm.input_write(event.data.data(), event.data.size());
+    auto t1 = Clock::now();
+    parse += t1 - t0;
+    if (!renderer) {
+      continue;
+    }
+
+    renderer->Update();
+    renderer->SetDirty();
+    auto render_screen = renderer->BeginRender();
+    renderer->RenderScreen(rows, cols, vterm);
+    auto t2 = Clock::now();
+    renderer->EndRender(render_screen, cfg.width, cfg.height);
+    auto t3 = Clock::now();
+    render += t2 - t1;
+    present += t3 - t2;
+    ++frames;
+    if (app) {
+      // keep the window responsive
+      SDL_PumpEvents();
+    }
+  }
+  auto total = Clock::now() - start;
+
+  double mb = recording.bytes / (1024.0 * 1024.0);
+  std::cout << "replay: " << cfg.replay << std::endl;
+  std::cout << "  events: " << recording.events.size() << ", " << mb << " MB"
+            << std::endl;
+  PrintStage("parse", parse, 0);
+  std::cout << "  parse throughput: " << mb / (Millis(parse) / 1000.0)
+            << " MB/s" << std::endl;
+  std::cout << "  frames: " << frames << " ("
+            << (renderer ? cfg.render : "not rendered") << ")" << std::endl;
+  if (frames) {
+    PrintStage("render", render, frames);
+    PrintStage("present", present, frames);
+  }
+  PrintStage("total", total, 0);
+
+  renderer.reset();
+  FOX_Exit();
+  if (offscreen) {
+    SDL_Quit();
+  }
+  return 0;
+}
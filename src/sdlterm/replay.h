@@ -0,0 +1,6 @@
+#pragma once
+#include "term_config.h"
+
+// Feeds cfg.replay to a terminal as fast as possible, optionally rendering
+// every chunk, and prints throughput and per-stage timings.
+int RunReplay(const TERM_Config &cfg);
@@ -0,0 +1,54 @@
+#include "rowcache.h"
+
+RowCache::~RowCache() { Reset(0, 0, 0); }
+
+void RowCache::Reset(int width, int height, size_t capacity) {
+  for (auto &entry : lru_) {
+    SDL_DestroyTexture(entry.texture);
+  }
+  lru_.clear();
+  map_.clear();
+  width_ = width;
+  height_ = height;
+  capacity_ = capacity;
+  map_.reserve(capacity);
+}
+
+SDL_Texture *RowCache::Find(uint64_t hash) {
+  auto found = map_.find(hash);
+  if (found == map_.end()) {
+    ++misses;
+    return nullptr;
+  }
+  ++hits;
+  lru_.splice(lru_.begin(), lru_, found->second);
+  return found->second->texture;
+}
+
+SDL_Texture *RowCache::Insert(SDL_Renderer *renderer, uint64_t hash) {
+  if (capacity_ == 0 || width_ <= 0 || height_ <= 0) {
+    return nullptr;
+  }
+
+  if (lru_.size() >= capacity_) {
+    // reuse the texture, list and map nodes of the oldest strip, a full
+    // cache recycles without allocating
+    auto oldest = std::prev(lru_.end());
+    auto node = map_.extract(oldest->hash);
+    oldest->hash = hash;
+    lru_.splice(lru_.begin(), lru_, oldest);
+    node.key() = hash;
+    node.mapped() = lru_.begin();
+    map_.insert(std::move(node));
+    return oldest->texture;
+  }
+
+  auto texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888,
+                                   SDL_TEXTUREACCESS_TARGET, width_, height_);
+  if (!texture) {
+    return nullptr;
+  }
+  lru_.push_front({hash, texture});
+  map_.emplace(hash, lru_.begin());
+  return lru_.front().texture;
+}
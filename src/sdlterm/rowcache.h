@@ -0,0 +1,42 @@
+#pragma once
+#include <SDL.h>
+#include <cstdint>
+#include <list>
+#include <unordered_map>
+
+// Rendered terminal rows kept as strip textures, keyed by a hash of the
+// row content. A row that hashes to a known strip is drawn with a single
+// copy instead of a fill and a glyph lookup per cell. Least recently used
+// strips are recycled once the cache is full.
+class RowCache {
+  struct Entry {
+    uint64_t hash;
+    SDL_Texture *texture;
+  };
+  // front is the most recently used
+  std::list<Entry> lru_;
+  std::unordered_map<uint64_t, std::list<Entry>::iterator> map_;
+  size_t capacity_ = 0;
+  int width_ = 0;
+  int height_ = 0;
+
+public:
+  RowCache() = default;
+  RowCache(const RowCache &) = delete;
+  RowCache &operator=(const RowCache &) = delete;
+  ~RowCache();
+
+  // lookups since the last Reset, for the frame profiler
+  Uint32 hits = 0;
+  Uint32 misses = 0;
+
+  int Width() const { return width_; }
+  int Height() const { return height_; }
+
+  // drops every strip, call whenever the strip size changes
+  void Reset(int width, int height, size_t capacity);
+  // the strip holding hash or nullptr
+  SDL_Texture *Find(uint64_t hash);
+  // a strip to render hash into, recycling the least recently used one
+  SDL_Texture *Insert(SDL_Renderer *renderer, uint64_t hash);
+};
@@ -1,39 +1,90 @@
 #include "sdlrenderer.h"
 #include "SDL_pixels.h"
 #include "vterm.h"
+#include <algorithm>
+#include <alloc_counter.h>
 #include <iostream>
+#include <trace.h>
 
 SDLRenderer::SDLRenderer(SDL_Renderer *renderer) : renderer_(renderer) {}
 SDLRenderer::~SDLRenderer() {
   std::cout << "SDLRenderer::~SDLRenderer\n";
+  CloseFallbackFonts();
+  for (auto &screen : screens_) {
+    if (screen.texture) {
+      SDL_DestroyTexture(screen.texture);
+    }
+  }
   if (font_bold) {
     FOX_CloseFont(this->font_bold);
   }
   if (font_regular) {
     FOX_CloseFont(this->font_regular);
   }
+  // textures die with their renderer, free them while it still exists
+  this->box_sprites_.Release();
+  this->row_cache_.Reset(0, 0, 0);
   SDL_DestroyRenderer(this->renderer_);
+  if (surface_) {
+    SDL_FreeSurface(this->surface_);
+  }
 }
 std::shared_ptr<SDLRenderer> SDLRenderer::Create(SDL_Window *window) {
-  auto renderer = SDL_CreateRenderer(window, -1, 0);
+  // presents in step with the display, no tearing
+  auto renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_PRESENTVSYNC);
+  if (!renderer) {
+    renderer = SDL_CreateRenderer(window, -1, 0);
+  }
+  if (!renderer) {
+    return nullptr;
+  }
+
+  auto ptr = std::shared_ptr<SDLRenderer>(new SDLRenderer(renderer));
+  SDL_RendererInfo info;
+  if (SDL_GetRendererInfo(renderer, &info) == 0) {
+    ptr->vsync_ = (info.flags & SDL_RENDERER_PRESENTVSYNC) != 0;
+  }
+  ptr->ticks = SDL_GetTicks();
+  ptr->row_cache_enabled_ = SDL_RenderTargetSupported(renderer);
+  return ptr;
+}
+
+std::shared_ptr<SDLRenderer> SDLRenderer::CreateOffscreen(int width,
+                                                          int height) {
+  auto surface = SDL_CreateRGBSurfaceWithFormat(0, width, height, 32,
+                                                SDL_PIXELFORMAT_ARGB8888);
+  if (!surface) {
+    return nullptr;
+  }
+  auto renderer = SDL_CreateSoftwareRenderer(surface);
   if (!renderer) {
+    SDL_FreeSurface(surface);
     return nullptr;
   }
 
   auto ptr = std::shared_ptr<SDLRenderer>(new SDLRenderer(renderer));
+  ptr->surface_ = surface;
   ptr->ticks = SDL_GetTicks();
+  ptr->row_cache_enabled_ = SDL_RenderTargetSupported(renderer);
   return ptr;
 }
 
 bool SDLRenderer::LoadFont(const char *fontpattern, int fontsize,
                            const char *boldfontpattern) {
+  TRACE_SCOPE("SDLRenderer::LoadFont");
   this->font_regular = FOX_OpenFont(this->renderer_, fontpattern, fontsize);
   if (!this->font_regular) {
     return false;
   }
   this->fontpattern = fontpattern;
   this->font_metrics = FOX_QueryFontMetrics(this->font_regular);
+  InvalidateRows();
+  this->box_sprites_.Build(this->renderer_, this->font_metrics->max_advance,
+                           this->font_metrics->height);
 
+  if (!boldfontpattern) {
+    return true;
+  }
   this->font_bold = FOX_OpenFont(this->renderer_, boldfontpattern, fontsize);
   if (!this->font_bold) {
     return false;
@@ -43,38 +94,82 @@ bool SDLRenderer::LoadFont(const char *fontpattern, int fontsize,
   return true;
 }
 
+FOX_Font *SDLRenderer::OpenFallbackFont(const char *fontpattern,
+                                        int fontsize) {
+  // fallback fonts tend to be huge (CJK), only rasterize what is used
+  auto font =
+      FOX_OpenFontEx(this->renderer_, fontpattern, fontsize, FOX_FONT_LAZY);
+  if (!font) {
+    return nullptr;
+  }
+  FOX_AddFallbackFont(this->font_regular, font);
+  if (this->font_bold) {
+    FOX_AddFallbackFont(this->font_bold, font);
+  }
+  this->fallbacks.push_back(font);
+  return font;
+}
+
+void SDLRenderer::CloseFallbackFonts() {
+  for (auto font : this->fallbacks) {
+    FOX_CloseFont(font);
+  }
+  this->fallbacks.clear();
+}
+
+bool SDLRenderer::AddFallbackFont(const char *fontpattern) {
+  TRACE_SCOPE("SDLRenderer::AddFallbackFont");
+  if (!OpenFallbackFont(fontpattern, this->font_metrics->ptsize)) {
+    return false;
+  }
+  this->fallbackpatterns.push_back(fontpattern);
+  // rows with previously missing glyphs look different now
+  InvalidateRows();
+  return true;
+}
+
 bool SDLRenderer::ResizeFont(int size) {
+  TRACE_SCOPE("SDLRenderer::ResizeFont");
   FOX_CloseFont(this->font_regular);
-  FOX_CloseFont(this->font_bold);
+  if (this->font_bold) {
+    FOX_CloseFont(this->font_bold);
+    this->font_bold = nullptr;
+  }
+  CloseFallbackFonts();
   this->font_regular =
       FOX_OpenFont(this->renderer_, this->fontpattern.c_str(), size);
   if (!this->font_regular) {
     return false;
   }
 
-  this->font_bold =
-      FOX_OpenFont(this->renderer_, this->boldfontpattern.c_str(), size);
-  if (!this->font_bold) {
-    return false;
+  if (!this->boldfontpattern.empty()) {
+    this->font_bold =
+        FOX_OpenFont(this->renderer_, this->boldfontpattern.c_str(), size);
+    if (!this->font_bold) {
+      return false;
+    }
   }
   this->font_metrics = FOX_QueryFontMetrics(this->font_regular);
+  this->box_sprites_.Build(this->renderer_, this->font_metrics->max_advance,
+                           this->font_metrics->height);
+  InvalidateRows();
+  for (auto &pattern : this->fallbackpatterns) {
+    OpenFallbackFont(pattern.c_str(), size);
+  }
   return true;
   ;
 }
 
-bool SDLRenderer::BeginRender() {
+void SDLRenderer::InvalidateRows() {
+  this->row_cache_.Reset(0, 0, 0);
+  for (auto &screen : this->screens_) {
+    std::fill(screen.hashes.begin(), screen.hashes.end(), 0);
+  }
+}
 
+bool SDLRenderer::Update() {
   this->ticks = SDL_GetTicks();
 
-  auto screen_render = this->dirty;
-  if (this->dirty) {
-    SDL_SetRenderDrawColor(this->renderer_, 0, 0, 0, 255);
-    SDL_RenderClear(this->renderer_);
-    SDL_SetRenderDrawColor(this->renderer_, 255, 255, 255, 255);
-
-    // RenderScreen(rows, cols, width, height);
-  }
-
   if (this->ticks > (this->cursor.ticks + 250)) {
     this->cursor.ticks = this->ticks;
     this->cursor.visible = !this->cursor.visible;
@@ -83,81 +178,372 @@ bool SDLRenderer::BeginRender() {
 
   if (this->bell.active && (this->ticks > (this->bell.ticks + 250))) {
     this->bell.active = false;
+    this->dirty = true;
+  }
+
+  // the profiler graph moves every frame
+  if (this->profiler_.visible) {
+    this->dirty = true;
+  }
+  return this->dirty;
+}
+
+Uint32 SDLRenderer::NextUpdate() const {
+  auto now = SDL_GetTicks();
+  auto due = [now](Uint32 at) { return at > now ? at - now : 0; };
+  auto next = due(this->cursor.ticks + 251);
+  if (this->bell.active) {
+    next = std::min(next, due(this->bell.ticks + 251));
+  }
+  return next;
+}
+
+bool SDLRenderer::BeginRender() {
+  this->render_start_ = SDL_GetPerformanceCounter();
+
+  auto screen_render = this->dirty;
+  if (this->dirty) {
+    SDL_SetRenderDrawColor(this->renderer_, 0, 0, 0, 255);
+    SDL_RenderClear(this->renderer_);
+    SDL_SetRenderDrawColor(this->renderer_, 255, 255, 255, 255);
+
+    // RenderScreen(rows, cols, width, height);
   }
 
   return screen_render;
 }
 
 void SDLRenderer::EndRender(bool screen_render, int width, int height) {
+  TRACE_SCOPE("SDLRenderer::EndRender");
   if (screen_render) {
-    RenderCursor();
     this->dirty = false;
-
+    this->list_.ClearOverlays();
+    AddCursor();
     if (this->bell.active) {
-      SDL_Rect rect = {0, 0, width, height};
-      SDL_RenderDrawRect(this->renderer_, &rect);
+      this->list_.AddFrame({0, 0, width, height}, {255, 255, 255, 255});
+    }
+    if (this->progress_ >= 0) {
+      AddProgress();
+    }
+    if (!this->overlay_.empty()) {
+      AddOverlayText();
     }
+    if (this->profiler_.visible) {
+      AddProfiler();
+    }
+  }
+
+  auto &frame = this->profiler_.current;
+  for (auto font : {this->font_regular, this->font_bold}) {
+    if (font) {
+      Uint32 hits, misses;
+      FOX_GetGlyphCacheStats(font, &hits, &misses);
+      FOX_ResetGlyphCacheStats(font);
+      frame.glyph_hits += hits;
+      frame.glyph_misses += misses;
+    }
+  }
+  auto allocations = termtk::ThreadAllocationCount();
+  frame.allocations = allocations - this->allocations_;
+  this->allocations_ = allocations;
+  frame.row_hits = this->row_cache_.hits;
+  frame.row_misses = this->row_cache_.misses;
+  this->row_cache_.hits = 0;
+  this->row_cache_.misses = 0;
+  if (screen_render) {
+    DrawOverlays(this->list_);
+    // overlay text is not part of the terminal's glyph traffic
+    FOX_ResetGlyphCacheStats(this->font_regular);
   }
+  frame.render_ms = FrameProfiler::Milliseconds(this->render_start_,
+                                                SDL_GetPerformanceCounter());
 
   // if (mouse_clicked) {
   //   SDL_RenderDrawRect(this->renderer_, &mouse_rect);
   // }
 
-  SDL_RenderPresent(this->renderer_);
+  auto present_start = SDL_GetPerformanceCounter();
+  {
+    TRACE_SCOPE("SDL_RenderPresent");
+    SDL_RenderPresent(this->renderer_);
+  }
+  frame.present_ms = FrameProfiler::Milliseconds(present_start,
+                                                 SDL_GetPerformanceCounter());
+  this->profiler_.EndFrame();
+}
+
+void SDLRenderer::AddProfiler() {
+  int width, height;
+  if (SDL_GetRendererOutputSize(this->renderer_, &width, &height) != 0) {
+    return;
+  }
+  this->profiler_.Render(this->list_, this->font_metrics, height);
 }
 
-void SDLRenderer::RenderCursor() {
+void SDLRenderer::AddCursor() {
   if (this->cursor.active && this->cursor.visible) {
     SDL_Rect rect = {this->cursor.position.x * this->font_metrics->max_advance,
                      4 + this->cursor.position.y * this->font_metrics->height,
                      4, this->font_metrics->height};
-    SDL_RenderFillRect(this->renderer_, &rect);
+    this->list_.AddFill(rect, {255, 255, 255, 255});
   }
 }
 
-void SDLRenderer::RenderCell(const VTermPos &pos, const VTermScreenCell &cell) {
-  FOX_Font *font = this->font_regular;
-  SDL_Point cursor = {pos.col * this->font_metrics->max_advance,
-                      pos.row * this->font_metrics->height};
-
-  SDL_Color fg = {
-      .r = cell.fg.rgb.red,
-      .g = cell.fg.rgb.green,
-      .b = cell.fg.rgb.blue,
-      .a = 255,
-  };
-  SDL_Color bg = {
-      .r = cell.bg.rgb.red,
-      .g = cell.bg.rgb.green,
-      .b = cell.bg.rgb.blue,
-      .a = 255,
-  };
-  if (cell.attrs.reverse) {
-    // auto tmp = fg;
-    // fg = bg;
-    // bg = tmp;
-    fg.r = ~fg.r;
-    fg.g = ~fg.g;
-    fg.b = ~fg.b;
-    bg.r = ~bg.r;
-    bg.g = ~bg.g;
-    bg.b = ~bg.b;
+bool SDLRenderer::PrepareScreen(ScreenTexture &screen, int width, int rows) {
+  int height = rows * this->font_metrics->height;
+  if (screen.texture && screen.width == width && screen.height == height) {
+    return true;
+  }
+  if (screen.texture) {
+    SDL_DestroyTexture(screen.texture);
+  }
+  screen.texture =
+      SDL_CreateTexture(this->renderer_, SDL_PIXELFORMAT_ARGB8888,
+                        SDL_TEXTUREACCESS_TARGET, width, height);
+  screen.width = width;
+  screen.height = height;
+  // 0 never matches, every row is rendered once
+  screen.hashes.assign(rows, 0);
+  return screen.texture != nullptr;
+}
+
+void SDLRenderer::AddDamage(const termtk::DamageList &damaged) {
+  this->track_damage_ = true;
+  for (auto &pos : damaged) {
+    if (pos.row >= (int)this->damaged_rows_.size()) {
+      this->damaged_rows_.resize(pos.row + 1, 0);
+    }
+    this->damaged_rows_[pos.row] = 1;
+  }
+}
+
+void SDLRenderer::RenderScreen(int rows, int cols,
+                               const termtk::Terminal &vterm) {
+  TRACE_SCOPE("SDLRenderer::RenderScreen");
+  int width = cols * this->font_metrics->max_advance;
+  int height = this->font_metrics->height;
+  auto &screen = this->screens_[vterm.altscreen() ? 1 : 0];
+  this->list_.Clear();
+  if (this->damaged_rows_.size() < (size_t)rows) {
+    this->damaged_rows_.resize(rows, 0);
+  }
+  if (!this->row_cache_enabled_ || !PrepareScreen(screen, width, rows)) {
+    // BeginRender cleared the whole target
+    for (int row = 0; row < rows; row++) {
+      this->list_.AddRow(vterm, row, cols, 0);
+    }
+    for (auto &row : this->list_.rows) {
+      DrawRow(this->list_, row, row.row * height + 4, true);
+    }
+    std::fill(this->damaged_rows_.begin(), this->damaged_rows_.end(), 0);
+    return;
+  }
+  if (this->row_cache_.Width() != width ||
+      this->row_cache_.Height() != height) {
+    // room for the primary and the alternate screen plus some churn
+    this->row_cache_.Reset(width, height, rows * 3);
+  }
+
+  // only the rows that differ from what the screen texture shows. A row
+  // vterm did not damage still shows what it was rendered from, unless
+  // the texture row was never rendered (hash 0). Switching screens
+  // damages every row, so the other texture is compared in full.
+  for (int row = 0; row < rows; row++) {
+    if (this->track_damage_ && !this->damaged_rows_[row] &&
+        screen.hashes[row] != 0) {
+      continue;
+    }
+    auto hash = vterm.row_hash(row, cols);
+    if (screen.hashes[row] != hash) {
+      this->list_.AddRow(vterm, row, cols, hash);
+    }
+  }
+
+  SDL_SetRenderTarget(this->renderer_, screen.texture);
+  for (auto &row : this->list_.rows) {
+    RenderRow(row, {0, row.row * height, width, height});
+    screen.hashes[row.row] = row.hash;
+  }
+  SDL_SetRenderTarget(this->renderer_, nullptr);
+  std::fill(this->damaged_rows_.begin(), this->damaged_rows_.end(), 0);
+
+  SDL_Rect dst = {0, 4, width, rows * height};
+  SDL_RenderCopy(this->renderer_, screen.texture, nullptr, &dst);
+  this->profiler_.current.draw_calls++;
+  SDL_SetRenderDrawColor(this->renderer_, 255, 255, 255, 255);
+}
+
+void SDLRenderer::RenderRow(const RenderList::Row &row, const SDL_Rect &dst) {
+  auto target = SDL_GetRenderTarget(this->renderer_);
+  auto strip = this->row_cache_.Find(row.hash);
+  if (!strip) {
+    strip = this->row_cache_.Insert(this->renderer_, row.hash);
+    if (strip && SDL_SetRenderTarget(this->renderer_, strip) == 0) {
+      SDL_SetRenderDrawColor(this->renderer_, 0, 0, 0, 255);
+      SDL_RenderClear(this->renderer_);
+      DrawRow(this->list_, row, 0, true);
+      SDL_SetRenderTarget(this->renderer_, target);
+    } else {
+      strip = nullptr;
+    }
+  }
+  if (strip) {
+    SDL_RenderCopy(this->renderer_, strip, nullptr, &dst);
+    this->profiler_.current.draw_calls++;
+    return;
+  }
+  // no strip, draw the cells straight into the screen texture
+  SDL_SetRenderDrawColor(this->renderer_, 0, 0, 0, 255);
+  SDL_RenderFillRect(this->renderer_, &dst);
+  this->profiler_.current.draw_calls++;
+  DrawRow(this->list_, row, dst.y, true);
+}
+
+void SDLRenderer::AddProgress() {
+  int width, height;
+  if (SDL_GetRendererOutputSize(this->renderer_, &width, &height) != 0) {
+    return;
+  }
+  SDL_Rect rect = {0, height - 4, width, 4};
+  this->list_.AddFill(rect, {64, 64, 64, 255});
+  rect.w = (int)(width * this->progress_);
+  this->list_.AddFill(rect, {80, 160, 255, 255});
+}
+
+void SDLRenderer::AddOverlayText() {
+  int width, height;
+  if (SDL_GetRendererOutputSize(this->renderer_, &width, &height) != 0) {
+    return;
+  }
+  int lines = 1;
+  int columns = 0;
+  int column = 0;
+  for (auto ch : this->overlay_) {
+    if (ch == '\n') {
+      ++lines;
+      column = 0;
+    } else {
+      columns = std::max(columns, ++column);
+    }
+  }
+
+  int pad = 4;
+  SDL_Rect rect = {0, 0, columns * this->font_metrics->max_advance + pad * 2,
+                   lines * this->font_metrics->height + pad * 2};
+  rect.x = width - rect.w;
+  this->list_.AddFill(rect, {0, 0, 0, 192});
+  this->list_.AddText(rect.x + pad, rect.y + pad - 4, {255, 255, 160, 255},
+                      this->overlay_.c_str());
+}
+
+void SDLRenderer::DrawOverlays(const RenderList &list) {
+  for (auto &overlay : list.overlays) {
+    auto &color = overlay.color;
+    SDL_SetRenderDrawBlendMode(this->renderer_, color.a < 255
+                                                    ? SDL_BLENDMODE_BLEND
+                                                    : SDL_BLENDMODE_NONE);
+    SDL_SetRenderDrawColor(this->renderer_, color.r, color.g, color.b,
+                           color.a);
+    switch (overlay.kind) {
+    case RenderList::Overlay::Fill:
+      SDL_RenderFillRect(this->renderer_, &overlay.rect);
+      break;
+    case RenderList::Overlay::Frame:
+      SDL_RenderDrawRect(this->renderer_, &overlay.rect);
+      break;
+    case RenderList::Overlay::Text: {
+      FOX_SetFontStyle(this->font_regular, FOX_STYLE_NORMAL);
+      SDL_Point pos = {overlay.rect.x, overlay.rect.y};
+      FOX_RenderText(this->font_regular,
+                     (const Uint8 *)list.overlay_text.c_str() + overlay.text,
+                     &pos);
+      break;
+    }
+    }
+    this->profiler_.current.draw_calls++;
   }
+  SDL_SetRenderDrawBlendMode(this->renderer_, SDL_BLENDMODE_NONE);
+  SDL_SetRenderDrawColor(this->renderer_, 255, 255, 255, 255);
+}
+
+void SDLRenderer::RenderCell(const VTermPos &pos, const VTermScreenCell &cell) {
+  this->cell_list_.Clear();
+  this->cell_list_.AddCell(pos.row, pos.col, cell);
+  DrawRow(this->cell_list_, this->cell_list_.rows[0],
+          pos.row * this->font_metrics->height + 4, false);
+}
+
+void SDLRenderer::DrawRow(const RenderList &list, const RenderList::Row &row,
+                          int y, bool cleared) {
+  int advance = this->font_metrics->max_advance;
+  int height = this->font_metrics->height;
 
   // BG
-  SDL_Rect rect = {cursor.x, cursor.y + 4, this->font_metrics->max_advance,
-                   this->font_metrics->height};
-  SDL_SetRenderDrawColor(this->renderer_, bg.r, bg.g, bg.b, bg.a);
-  SDL_RenderFillRect(this->renderer_, &rect);
+  for (auto i = row.runs_begin; i < row.runs_end; ++i) {
+    auto &run = list.runs[i];
+    auto &bg = run.color;
+    if (cleared && bg.r == 0 && bg.g == 0 && bg.b == 0) {
+      continue;
+    }
+    SDL_Rect rect = {run.col * advance, y, run.count * advance, height};
+    SDL_SetRenderDrawColor(this->renderer_, bg.r, bg.g, bg.b, bg.a);
+    SDL_RenderFillRect(this->renderer_, &rect);
+    this->profiler_.current.draw_calls++;
+  }
 
   // FG
-  if (cell.attrs.bold) {
-    font = this->font_bold;
-  } else if (cell.attrs.italic) {
+  for (auto i = row.glyphs_begin; i < row.glyphs_end; ++i) {
+    auto &glyph = list.glyphs[i];
+    auto &fg = glyph.color;
+    this->profiler_.current.draw_calls++;
+    if (BoxSprites::Contains(glyph.ch)) {
+      // lines and blocks fill the exact cell rect, no font involved
+      SDL_Rect rect = {glyph.col * advance, y, advance, height};
+      this->box_sprites_.Render(this->renderer_, glyph.ch, rect, fg);
+      continue;
+    }
+    FOX_Font *font = this->font_regular;
+    int style = FOX_STYLE_NORMAL;
+    if (glyph.bold) {
+      if (this->font_bold) {
+        font = this->font_bold;
+      } else {
+        style |= FOX_STYLE_BOLD;
+      }
+    }
+    if (glyph.italic) {
+      style |= FOX_STYLE_ITALIC;
+    }
+    // glyphs are positioned 4 pixels above the cell background
+    SDL_Point cursor = {glyph.col * advance, y - 4};
+    SDL_SetRenderDrawColor(this->renderer_, fg.r, fg.g, fg.b, fg.a);
+    FOX_SetFontStyle(font, style);
+    FOX_RenderChar(font, glyph.ch, 0, &cursor);
   }
-  if (auto ch = cell.chars[0]) {
+
+  // underline and strikethrough
+  int thickness = std::max(1, height / 16);
+  for (auto i = row.decorations_begin; i < row.decorations_end; ++i) {
+    auto &decoration = list.decorations[i];
+    auto &fg = decoration.color;
+    SDL_Rect rect = {decoration.col * advance, 0, decoration.count * advance,
+                     thickness};
     SDL_SetRenderDrawColor(this->renderer_, fg.r, fg.g, fg.b, fg.a);
-    FOX_RenderChar(font, ch, 0, &cursor);
+    switch (decoration.kind) {
+    case RenderList::Decoration::DoubleUnderline:
+      rect.y = y + height - thickness * 4;
+      SDL_RenderFillRect(this->renderer_, &rect);
+      this->profiler_.current.draw_calls++;
+      [[fallthrough]];
+    case RenderList::Decoration::Underline:
+      rect.y = y + height - thickness * 2;
+      break;
+    case RenderList::Decoration::Strike:
+      rect.y = y + height / 2;
+      break;
+    }
+    SDL_RenderFillRect(this->renderer_, &rect);
+    this->profiler_.current.draw_calls++;
   }
 }
 // return &cell;
@@ -2,26 +2,65 @@
 #include "SDL_pixels.h"
 #include "SDL_rect.h"
 #include "TERM_Rect.h"
+#include "boxdrawing.h"
+#include "profiler.h"
+#include "renderlist.h"
+#include "rowcache.h"
 #include <SDL.h>
 #include <SDL_fox.h>
 #include <memory>
 #include <string>
+#include <vector>
 #include <vterm.h>
+#include <vterm_object.h>
 
 class SDLRenderer {
   SDL_Renderer *renderer_;
+  // the render target of offscreen renderers
+  SDL_Surface *surface_ = nullptr;
 
   bool dirty = true;
+  // the present waits for the display refresh
+  bool vsync_ = false;
 
   std::string fontpattern;
-  FOX_Font *font_regular;
+  FOX_Font *font_regular = nullptr;
   std::string boldfontpattern;
-  FOX_Font *font_bold;
+  FOX_Font *font_bold = nullptr;
+  std::vector<std::string> fallbackpatterns;
+  std::vector<FOX_Font *> fallbacks;
+  BoxSprites box_sprites_;
+  RowCache row_cache_;
+  bool row_cache_enabled_ = false;
+  // the rows and overlays drawn this frame, and the scratch list of
+  // RenderCell
+  RenderList list_;
+  RenderList cell_list_;
+  // the rendered primary and alternate screens, each row tagged with the
+  // hash it was rendered from. The primary screen survives while a full
+  // screen app runs, switching back only redraws rows that changed.
+  struct ScreenTexture {
+    SDL_Texture *texture = nullptr;
+    int width = 0;
+    int height = 0;
+    std::vector<uint64_t> hashes;
+  } screens_[2];
+  // rows vterm damaged since the last RenderScreen; once damage is
+  // reported, rows not listed here are neither read nor hashed
+  std::vector<uint8_t> damaged_rows_;
+  bool track_damage_ = false;
   Uint32 ticks;
   struct {
     Uint32 ticks = 0;
     bool active = false;
   } bell;
+  // paste progress 0 to 1, hidden when negative
+  float progress_ = -1.0f;
+  // debug text drawn over the top right corner
+  std::string overlay_;
+  FrameProfiler profiler_;
+  Uint64 render_start_ = 0;
+  size_t allocations_ = 0;
 
   SDLRenderer(SDL_Renderer *renderer);
 
@@ -36,16 +75,45 @@ public:
 
   ~SDLRenderer();
   static std::shared_ptr<SDLRenderer> Create(SDL_Window *window);
+  // software renderer drawing into a surface, no window or video needed
+  static std::shared_ptr<SDLRenderer> CreateOffscreen(int width, int height);
+  // without boldfontpattern, bold is synthesized from the regular font
   bool LoadFont(const char *fontpattern, int fontsize,
                 const char *boldfontpattern);
+  bool AddFallbackFont(const char *fontpattern);
   void SetDirty() { this->dirty = true; }
+  // forget rendered rows, e.g. after the fonts changed
+  void InvalidateRows();
+  // the render target of offscreen renderers, nullptr otherwise
+  SDL_Surface *Surface() const { return this->surface_; }
   bool ResizeFont(int d);
+  bool Vsync() const { return this->vsync_; }
+  // advances the cursor blink and the bell, true if a frame is needed.
+  // Call once per frame before BeginRender, which does not
+  bool Update();
+  // ms until Update changes something on its own
+  Uint32 NextUpdate() const;
   bool BeginRender();
   void EndRender(bool render_screen, int width, int height);
   void SetBell() {
     bell.active = true;
     bell.ticks = ticks;
   }
+  void SetProgress(float progress) {
+    this->progress_ = progress;
+    this->dirty = true;
+  }
+  void SetOverlay(const std::string &text) {
+    if (text != this->overlay_) {
+      this->overlay_ = text;
+      this->dirty = true;
+    }
+  }
+  FrameProfiler &Profiler() { return this->profiler_; }
+  void ToggleProfiler() {
+    this->profiler_.visible = !this->profiler_.visible;
+    this->dirty = true;
+  }
   void MoveCursor(int row, int col, bool visible) {
     cursor.position.x = col;
     cursor.position.y = row;
@@ -57,11 +125,29 @@ public:
     }
   }
   void RenderCell(const VTermPos &pos, const VTermScreenCell &cell);
+  // the cells of Terminal::new_frame, called for every frame of vterm
+  // whether it is rendered or not
+  void AddDamage(const termtk::DamageList &damaged);
+  // draws every row, reusing cached strips for rows whose content is known
+  void RenderScreen(int rows, int cols, const termtk::Terminal &vterm);
   TERM_Rect TermRect(const SDL_Rect &rect) const {
     return TERM_Rect::FromMouseRect(rect, this->font_metrics->height,
                                     this->font_metrics->max_advance);
   }
 
 private:
-  void RenderCursor();
+  // append to the overlays of list_, EndRender draws them
+  void AddCursor();
+  void AddProgress();
+  void AddOverlayText();
+  void AddProfiler();
+  void DrawOverlays(const RenderList &list);
+  // y is the top of the row background; backgrounds in the cleared color
+  // are skipped when the row was cleared before
+  void DrawRow(const RenderList &list, const RenderList::Row &row, int y,
+               bool cleared);
+  bool PrepareScreen(ScreenTexture &screen, int width, int rows);
+  void RenderRow(const RenderList::Row &row, const SDL_Rect &dst);
+  FOX_Font *OpenFallbackFont(const char *fontpattern, int fontsize);
+  void CloseFallbackFonts();
 };
@@ -1,11 +1,8 @@
 #include "term_config.h"
 #include <SDL.h>
 #include <stdio.h>
-#ifdef _MSC_VER
 #include <getopt.h>
-#else
-#include <unistd.h>
-#endif
+#include <iterator>
 #include <stdlib.h>
 
 #define COPYRIGHT                                                              \
@@ -23,12 +20,37 @@ static const char help[] = {
     "  -y\tSet window height in pixels\n"
     "  -f\tSet regular font via path (fontconfig pattern not yet supported)\n"
     "  -b\tSet bold font via path (fontconfig pattern not yet supported)\n"
+    "  -F\tAdd a fallback font via path (may be repeated)\n"
+    "  -S\tSynthesize bold from the regular font instead of loading -b\n"
     "  -s\tSet fontsize\n"
     "  -l\tList available SDL renderer backends\n"
     "  -w\tSet SDL window flags\n"
-    "  -e\tSet child process executable path\n"};
+    "  -e\tSet child process executable path\n"
+    "  -r\tRecord the session to an asciicast file\n"
+    "  --replay FILE\tFeed a raw or asciicast recording to the terminal as\n"
+    "\t\tfast as possible and report timings, no child is started\n"
+    "  --render BACKEND\tRender replayed frames through an SDL render\n"
+    "\t\t\tdriver or \"offscreen\"\n"
+    "  --latency-log FILE\tLog keypress to photon latency samples as CSV,\n"
+    "\t\t\tCtrl+Shift+F12 shows the summary\n"
+    "  --trace FILE\tWrite a Chrome trace of the hot paths on SIGUSR1 and\n"
+    "\t\tat exit, needs a build with TERMTK_TRACE\n"
+    "\nCtrl+Shift+F11 toggles the frame profiler\n"};
 
-static const char options[] = "hvlx:y:f:b:s:r:w:e:";
+static const char options[] = "hvlSx:y:f:b:F:s:r:w:e:";
+enum {
+  OPT_REPLAY = 256,
+  OPT_RENDER,
+  OPT_LATENCY_LOG,
+  OPT_TRACE,
+};
+static const struct option long_options[] = {
+    {"replay", required_argument, NULL, OPT_REPLAY},
+    {"render", required_argument, NULL, OPT_RENDER},
+    {"latency-log", required_argument, NULL, OPT_LATENCY_LOG},
+    {"trace", required_argument, NULL, OPT_TRACE},
+    {NULL, 0, NULL, 0},
+};
 static const char version[] = {PROGNAME "\n" COPYRIGHT};
 
 static void TERM_ListRenderBackends(void) {
@@ -45,7 +67,8 @@ int TERM_Config::ParseArgs(int argc, char **argv) {
   int status = 0;
 
   int option;
-  while ((option = getopt(argc, argv, options)) != -1) {
+  while ((option = getopt_long(argc, argv, options, long_options, NULL)) !=
+         -1) {
     switch (option) {
     case 'h':
       puts(help);
@@ -71,6 +94,15 @@ int TERM_Config::ParseArgs(int argc, char **argv) {
       if (optarg != NULL)
         this->boldfont = optarg;
       break;
+    case 'S':
+      this->synthetic_bold = true;
+      break;
+    case 'F':
+      if (optarg != NULL &&
+          this->nFallbackFonts < (int)std::size(this->fallbackfonts)) {
+        this->fallbackfonts[this->nFallbackFonts++] = optarg;
+      }
+      break;
     case 'w':
       if (optarg != NULL) {
         this->windowflags[this->nWindowFlags++] = optarg;
@@ -80,6 +112,22 @@ int TERM_Config::ParseArgs(int argc, char **argv) {
       if (optarg != NULL)
         this->exec = optarg;
       break;
+    case 'r':
+      if (optarg != NULL)
+        this->record = optarg;
+      break;
+    case OPT_REPLAY:
+      this->replay = optarg;
+      break;
+    case OPT_RENDER:
+      this->render = optarg;
+      break;
+    case OPT_LATENCY_LOG:
+      this->latency_log = optarg;
+      break;
+    case OPT_TRACE:
+      this->trace = optarg;
+      break;
     case 'l':
       TERM_ListRenderBackends();
       status = 1;
@@ -18,7 +18,22 @@ struct TERM_Config {
 
   const char *windowflags[5] = {0};
   int nWindowFlags = 0;
+  // searched in order for characters missing from the regular font
+  const char *fallbackfonts[4] = {0};
+  int nFallbackFonts = 0;
   int fontsize = 16;
+  // derive bold from the regular font instead of loading boldfont
+  bool synthetic_bold = false;
+  // asciicast file the session is recorded to
+  const char *record = nullptr;
+  // byte stream (raw or asciicast) fed to the terminal without a child
+  const char *replay = nullptr;
+  // "offscreen" or an SDL render driver, replays only parse without it
+  const char *render = nullptr;
+  // CSV of keypress to photon latency samples
+  const char *latency_log = nullptr;
+  // Chrome trace JSON, written on SIGUSR1 and at exit (TERMTK_TRACE builds)
+  const char *trace = nullptr;
   int width = 800;
   int height = 600;
 
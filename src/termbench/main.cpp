@@ -0,0 +1,390 @@
+// termbench: pushes generated workloads through termtk::Terminal and,
+// optionally, the offscreen renderer, and prints the results as JSON.
+#include <SDL.h>
+#include <SDL_fox.h>
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <getopt.h>
+#include <sdlrenderer.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <vterm_object.h>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// bytes handed to the parser at once, about one pty read
+constexpr size_t ChunkSize = 16 * 1024;
+
+struct Options {
+#ifdef _MSC_VER
+  const char *font = "C:/Windows/Fonts/consola.ttf";
+#else
+  const char *font = "/usr/share/fonts/truetype/dejavu/DejaVuSansMono.ttf";
+#endif
+  int fontsize = 16;
+  int rows = 24;
+  int cols = 80;
+  // workload size in MB
+  double megabytes = 8;
+  int iterations = 3;
+  bool render = false;
+  const char *only = nullptr;
+  const char *output = nullptr;
+};
+
+// deterministic, so every run sees the same bytes
+struct Random {
+  uint32_t state = 2463534242u;
+  uint32_t operator()(uint32_t n) {
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state % n;
+  }
+};
+
+void AppendUtf8(std::string &out, char32_t cp) {
+  if (cp < 0x80) {
+    out += (char)cp;
+  } else if (cp < 0x800) {
+    out += (char)(0xc0 | cp >> 6);
+    out += (char)(0x80 | (cp & 0x3f));
+  } else if (cp < 0x10000) {
+    out += (char)(0xe0 | cp >> 12);
+    out += (char)(0x80 | (cp >> 6 & 0x3f));
+    out += (char)(0x80 | (cp & 0x3f));
+  } else {
+    out += (char)(0xf0 | cp >> 18);
+    out += (char)(0x80 | (cp >> 12 & 0x3f));
+    out += (char)(0x80 | (cp >> 6 & 0x3f));
+    out += (char)(0x80 | (cp & 0x3f));
+  }
+}
+
+struct Workload {
+  const char *name;
+  // appends about one screen worth of output
+  std::function<void(std::string &, Random &, const Options &)> generate;
+};
+
+const std::vector<Workload> &Workloads() {
+  static const std::vector<Workload> workloads = {
+      {"dense_ascii",
+       [](std::string &out, Random &rnd, const Options &opt) {
+         for (int row = 0; row < opt.rows; ++row) {
+           for (int col = 0; col < opt.cols; ++col) {
+             out += (char)(' ' + 1 + rnd(94));
+           }
+           out += "\r\n";
+         }
+       }},
+      {"scroll_region",
+       [](std::string &out, Random &rnd, const Options &opt) {
+         char buf[32];
+         snprintf(buf, sizeof(buf), "\033[%d;%dr\033[%dH", 3, opt.rows - 2,
+                  opt.rows - 2);
+         out += buf;
+         for (int row = 0; row < opt.rows; ++row) {
+           for (int col = 0; col < opt.cols / 2; ++col) {
+             out += (char)('a' + rnd(26));
+           }
+           out += "\r\n";
+         }
+         out += "\033[r";
+       }},
+      {"sgr_256",
+       [](std::string &out, Random &rnd, const Options &opt) {
+         char buf[32];
+         for (int i = 0; i < opt.rows * opt.cols; ++i) {
+           snprintf(buf, sizeof(buf), "\033[38;5;%u;48;5;%um%c", rnd(256),
+                    rnd(256), (char)('A' + rnd(26)));
+           out += buf;
+         }
+         out += "\033[m\r\n";
+       }},
+      {"sgr_truecolor",
+       [](std::string &out, Random &rnd, const Options &opt) {
+         char buf[64];
+         for (int i = 0; i < opt.rows * opt.cols; ++i) {
+           snprintf(buf, sizeof(buf), "\033[38;2;%u;%u;%u;48;2;%u;%u;%um%c",
+                    rnd(256), rnd(256), rnd(256), rnd(256), rnd(256),
+                    rnd(256), (char)('A' + rnd(26)));
+           out += buf;
+         }
+         out += "\033[m\r\n";
+       }},
+      {"wide_cjk",
+       [](std::string &out, Random &rnd, const Options &opt) {
+         for (int row = 0; row < opt.rows; ++row) {
+           for (int col = 0; col + 1 < opt.cols; col += 2) {
+             AppendUtf8(out, 0x4e00 + rnd(0x5000));
+           }
+           out += "\r\n";
+         }
+       }},
+      {"combining",
+       [](std::string &out, Random &rnd, const Options &opt) {
+         for (int row = 0; row < opt.rows; ++row) {
+           for (int col = 0; col < opt.cols; ++col) {
+             out += (char)('a' + rnd(26));
+             // one or two marks from Combining Diacritical Marks
+             for (int n = 1 + rnd(2); n; --n) {
+               AppendUtf8(out, 0x300 + rnd(0x70));
+             }
+           }
+           out += "\r\n";
+         }
+       }},
+      {"cursor_motion",
+       [](std::string &out, Random &rnd, const Options &opt) {
+         // what a TUI repainting scattered fields looks like
+         char buf[32];
+         for (int i = 0; i < opt.rows * 4; ++i) {
+           snprintf(buf, sizeof(buf), "\033[%u;%uH", 1 + rnd(opt.rows),
+                    1 + rnd(opt.cols));
+           out += buf;
+           for (int n = 4 + rnd(12); n; --n) {
+             out += (char)('0' + rnd(10));
+           }
+           if (rnd(4) == 0) {
+             out += "\033[K";
+           }
+         }
+       }},
+      {"alt_screen",
+       [](std::string &out, Random &rnd, const Options &opt) {
+         out += "\033[?1049h\033[H\033[2J";
+         for (int row = 0; row < opt.rows; ++row) {
+           for (int col = 0; col < opt.cols; ++col) {
+             out += (char)('a' + rnd(26));
+           }
+           if (row + 1 < opt.rows) {
+             out += "\r\n";
+           }
+         }
+         out += "\033[?1049l";
+       }},
+  };
+  return workloads;
+}
+
+std::string Generate(const Workload &workload, const Options &opt) {
+  std::string out;
+  size_t target = (size_t)(opt.megabytes * 1024 * 1024);
+  out.reserve(target + 64 * 1024);
+  Random rnd;
+  while (out.size() < target) {
+    workload.generate(out, rnd, opt);
+  }
+  return out;
+}
+
+struct Result {
+  const char *name;
+  size_t bytes;
+  // best of the iterations, in ms
+  double parse;
+  double render;
+  double present;
+  int frames;
+};
+
+double Millis(Clock::duration d) {
+  return std::chrono::duration<double, std::milli>(d).count();
+}
+
+Result Run(const Workload &workload, const std::string &data,
+           const Options &opt, SDLRenderer *renderer) {
+  Result result = {workload.name, data.size(), 1e300, 1e300, 1e300, 0};
+  for (int i = 0; i < opt.iterations; ++i) {
+    termtk::Terminal vterm(
+        opt.rows, opt.cols, 0, 0, [](const char *, size_t, void *) {},
+        nullptr);
+    Clock::duration parse{};
+    Clock::duration render{};
+    Clock::duration present{};
+    int frames = 0;
+    if (renderer) {
+      // start cold, or later iterations only time row cache hits
+      renderer->InvalidateRows();
+      renderer->SetDirty();
+    }
+    for (size_t pos = 0; pos < data.size(); pos += ChunkSize) {
+      auto size = std::min(ChunkSize, data.size() - pos);
+      auto t0 = Clock::now();
+      vterm.input_write(data.data() + pos, size);
+      auto t1 = Clock::now();
+      parse += t1 - t0;
+      if (!renderer) {
+        continue;
+      }
+      renderer->Update();
+      renderer->SetDirty();
+      auto render_screen = renderer->BeginRender();
+      renderer->RenderScreen(opt.rows, opt.cols, vterm);
+      auto t2 = Clock::now();
+      renderer->EndRender(render_screen, 0, 0);
+      auto t3 = Clock::now();
+      render += t2 - t1;
+      present += t3 - t2;
+      ++frames;
+    }
+    result.parse = std::min(result.parse, Millis(parse));
+    result.render = std::min(result.render, Millis(render));
+    result.present = std::min(result.present, Millis(present));
+    result.frames = frames;
+  }
+  return result;
+}
+
+std::shared_ptr<SDLRenderer> CreateRenderer(const Options &opt) {
+  // the surface size depends on the font, measure it on a throwaway first
+  auto probe = SDLRenderer::CreateOffscreen(1, 1);
+  if (!probe || !probe->LoadFont(opt.font, opt.fontsize, nullptr)) {
+    return nullptr;
+  }
+  int width = opt.cols * probe->font_metrics->max_advance;
+  int height = opt.rows * probe->font_metrics->height + 4;
+  probe.reset();
+
+  auto renderer = SDLRenderer::CreateOffscreen(width, height);
+  if (!renderer || !renderer->LoadFont(opt.font, opt.fontsize, nullptr)) {
+    return nullptr;
+  }
+  return renderer;
+}
+
+void PrintJson(FILE *out, const Options &opt,
+               const std::vector<Result> &results) {
+  fprintf(out, "{\n");
+  fprintf(out, "  \"rows\": %d,\n  \"cols\": %d,\n", opt.rows, opt.cols);
+  fprintf(out, "  \"iterations\": %d,\n", opt.iterations);
+  fprintf(out, "  \"render\": %s,\n", opt.render ? "true" : "false");
+  fprintf(out, "  \"results\": [\n");
+  for (size_t i = 0; i < results.size(); ++i) {
+    auto &r = results[i];
+    double mb = r.bytes / (1024.0 * 1024.0);
+    fprintf(out,
+            "    {\"name\": \"%s\", \"bytes\": %zu, \"parse_ms\": %.3f, "
+            "\"parse_mb_per_s\": %.2f",
+            r.name, r.bytes, r.parse, r.parse > 0 ? mb / (r.parse / 1000) : 0);
+    if (opt.render) {
+      fprintf(out,
+              ", \"frames\": %d, \"render_ms\": %.3f, \"present_ms\": %.3f",
+              r.frames, r.render, r.present);
+    }
+    fprintf(out, "}%s\n", i + 1 < results.size() ? "," : "");
+  }
+  fprintf(out, "  ]\n}\n");
+}
+
+const char help[] =
+    "termbench usage:\n"
+    "\ttermbench [option...]\n"
+    "Options:\n"
+    "  -h\tDisplay help text\n"
+    "  -w\tRun only the named workload\n"
+    "  -n\tMegabytes generated per workload (default 8)\n"
+    "  -i\tIterations per workload, the best one is reported (default 3)\n"
+    "  -r\tRows of the terminal (default 24)\n"
+    "  -c\tColumns of the terminal (default 80)\n"
+    "  -R\tAlso render every chunk with the offscreen renderer\n"
+    "  -f\tFont used for rendering\n"
+    "  -s\tFont size used for rendering\n"
+    "  -o\tWrite the JSON results to a file instead of stdout\n";
+
+int ParseArgs(int argc, char **argv, Options &opt) {
+  int option;
+  while ((option = getopt(argc, argv, "hRw:n:i:r:c:f:s:o:")) != -1) {
+    switch (option) {
+    case 'w':
+      opt.only = optarg;
+      break;
+    case 'n':
+      opt.megabytes = strtod(optarg, NULL);
+      break;
+    case 'i':
+      opt.iterations = std::max(1, (int)strtol(optarg, NULL, 10));
+      break;
+    case 'r':
+      opt.rows = std::max(2, (int)strtol(optarg, NULL, 10));
+      break;
+    case 'c':
+      opt.cols = std::max(2, (int)strtol(optarg, NULL, 10));
+      break;
+    case 'R':
+      opt.render = true;
+      break;
+    case 'f':
+      opt.font = optarg;
+      break;
+    case 's':
+      opt.fontsize = (int)strtol(optarg, NULL, 10);
+      break;
+    case 'o':
+      opt.output = optarg;
+      break;
+    default:
+      fputs(help, stderr);
+      return 1;
+    }
+  }
+  return 0;
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+  Options opt;
+  if (ParseArgs(argc, argv, opt)) {
+    return 1;
+  }
+
+  std::shared_ptr<SDLRenderer> renderer;
+  if (opt.render) {
+    SDL_Init(SDL_INIT_EVENTS);
+    FOX_Init();
+    renderer = CreateRenderer(opt);
+    if (!renderer) {
+      fprintf(stderr, "fail to create the offscreen renderer\n");
+      return 3;
+    }
+  }
+
+  std::vector<Result> results;
+  for (auto &workload : Workloads()) {
+    if (opt.only && strcmp(opt.only, workload.name) != 0) {
+      continue;
+    }
+    fprintf(stderr, "%s...\n", workload.name);
+    auto data = Generate(workload, opt);
+    results.push_back(Run(workload, data, opt, renderer.get()));
+  }
+
+  FILE *out = stdout;
+  if (opt.output) {
+    out = fopen(opt.output, "w");
+    if (!out) {
+      fprintf(stderr, "fail to open: %s\n", opt.output);
+      return 2;
+    }
+  }
+  PrintJson(out, opt, results);
+  if (out != stdout) {
+    fclose(out);
+  }
+
+  if (renderer) {
+    renderer.reset();
+    FOX_Exit();
+    SDL_Quit();
+  }
+  return 0;
+}
@@ -0,0 +1,160 @@
+// termmicro: per-call cost of the paths that run rows * cols times per
+// frame, in ns and heap allocations per operation.
+#include <SDL.h>
+#include <SDL_fox.h>
+#include <alloc_counter.h>
+#include <chrono>
+#include <sdlrenderer.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <vterm_object.h>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct Grid {
+  int cols;
+  int rows;
+};
+const Grid grids[] = {{80, 24}, {160, 48}, {240, 72}, {400, 120}};
+
+struct Stat {
+  Clock::duration time{};
+  size_t allocations = 0;
+  int ops = 0;
+};
+
+// accumulates the time and allocations of f into stat
+template <typename F> void Measure(Stat &stat, F &&f) {
+  auto allocations = termtk::AllocationCount();
+  auto t0 = Clock::now();
+  f();
+  stat.time += Clock::now() - t0;
+  stat.allocations += termtk::AllocationCount() - allocations;
+  ++stat.ops;
+}
+
+void Report(const char *name, const Grid &grid, const Stat &stat) {
+  double ns = std::chrono::duration<double, std::nano>(stat.time).count() /
+              stat.ops;
+  printf("%-12s %4dx%-4d %14.1f %10.2f ", name, grid.cols, grid.rows, ns,
+         ns / (grid.cols * grid.rows));
+  if (termtk::CountsAllocations) {
+    printf("%14.1f\n", (double)stat.allocations / stat.ops);
+  } else {
+    printf("%14s\n", "-");
+  }
+}
+
+// a screen full of colored text, so every cell has content
+void Fill(termtk::Terminal &vterm, const Grid &grid) {
+  std::string text;
+  char sgr[32];
+  for (int row = 0; row < grid.rows; ++row) {
+    snprintf(sgr, sizeof(sgr), "\033[%d;%dH\033[3%dm", row + 1, 1, row % 8);
+    text += sgr;
+    for (int col = 0; col < grid.cols; ++col) {
+      text += (char)('!' + (row + col) % 94);
+    }
+  }
+  vterm.input_write(text.data(), text.size());
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+#ifdef _MSC_VER
+  const char *font = "C:/Windows/Fonts/consola.ttf";
+#else
+  const char *font = "/usr/share/fonts/truetype/dejavu/DejaVuSansMono.ttf";
+#endif
+  int iterations = 200;
+  if (argc > 1) {
+    iterations = atoi(argv[1]);
+  }
+  if (argc > 2) {
+    font = argv[2];
+  }
+
+  SDL_Init(SDL_INIT_EVENTS);
+  FOX_Init();
+
+  printf("%-12s %9s %14s %10s %14s\n", "benchmark", "grid", "ns/op",
+         "ns/cell", "allocs/op");
+  for (auto &grid : grids) {
+    termtk::Terminal vterm(
+        grid.rows, grid.cols, 0, 0, [](const char *, size_t, void *) {},
+        nullptr);
+    bool ringing;
+
+    // a full screen erase, damaging every cell, then the frame that
+    // consumes the damage
+    static const char erase[] = "\033[2J";
+    Stat damage;
+    Stat new_frame;
+    for (int i = 0; i < iterations; ++i) {
+      Measure(damage,
+              [&] { vterm.input_write(erase, sizeof(erase) - 1); });
+      Measure(new_frame, [&] { vterm.new_frame(&ringing); });
+    }
+    Report("erase", grid, damage);
+    Report("new_frame", grid, new_frame);
+
+    Fill(vterm, grid);
+    vterm.new_frame(&ringing);
+
+    Stat get_cell;
+    for (int i = 0; i < iterations; ++i) {
+      Measure(get_cell, [&] {
+        for (int row = 0; row < grid.rows; ++row) {
+          for (int col = 0; col < grid.cols; ++col) {
+            vterm.get_cell({.row = row, .col = col});
+          }
+        }
+      });
+    }
+    Report("get_cell", grid, get_cell);
+
+    // the frame as data, before any backend sees it
+    RenderList list;
+    Stat render_list;
+    for (int i = 0; i < iterations; ++i) {
+      Measure(render_list, [&] {
+        list.Clear();
+        for (int row = 0; row < grid.rows; ++row) {
+          list.AddRow(vterm, row, grid.cols, 0);
+        }
+      });
+    }
+    Report("RenderList", grid, render_list);
+
+    // software renderer into a surface that is never shown
+    auto renderer = SDLRenderer::CreateOffscreen(grid.cols * 16,
+                                                 grid.rows * 32 + 4);
+    if (!renderer || !renderer->LoadFont(font, 16, nullptr)) {
+      printf("%-12s %4dx%-4d skipped, no renderer or font\n", "RenderCell",
+             grid.cols, grid.rows);
+      continue;
+    }
+    Stat render_cell;
+    for (int i = 0; i < iterations; ++i) {
+      Measure(render_cell, [&] {
+        for (int row = 0; row < grid.rows; ++row) {
+          for (int col = 0; col < grid.cols; ++col) {
+            VTermPos pos = {.row = row, .col = col};
+            if (auto cell = vterm.get_cell(pos)) {
+              renderer->RenderCell(pos, *cell);
+            }
+          }
+        }
+      });
+    }
+    Report("RenderCell", grid, render_cell);
+  }
+
+  FOX_Exit();
+  SDL_Quit();
+  return 0;
+}
@@ -0,0 +1,378 @@
+// termshot: renders recordings with the offscreen renderer, no display or
+// GPU needed, and writes the final screen as a PPM image or compares it
+// with a golden image. Doubles as a render benchmark free of compositor
+// and vsync noise.
+#include <SDL.h>
+#include <SDL_fox.h>
+#include <algorithm>
+#include <chrono>
+#include <getopt.h>
+#include <recording.h>
+#include <sdlrenderer.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <vterm_object.h>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct Options {
+#ifdef _MSC_VER
+  const char *font = "C:/Windows/Fonts/consola.ttf";
+#else
+  const char *font = "/usr/share/fonts/truetype/dejavu/DejaVuSansMono.ttf";
+#endif
+  int fontsize = 16;
+  // image of a single input
+  const char *output = nullptr;
+  // goldens named after the inputs, <dir>/<input basename>.ppm
+  const char *golden_dir = nullptr;
+  // where the actual and diff images of mismatches go
+  const char *diff_dir = nullptr;
+  bool update = false;
+  // per channel difference still counted as equal
+  int tolerance = 0;
+  // differing pixels still accepted
+  long max_pixels = 0;
+  // full redraws timed per input
+  int iterations = 0;
+};
+
+struct Image {
+  int width = 0;
+  int height = 0;
+  // packed RGB rows, no padding
+  std::vector<uint8_t> rgb;
+};
+
+Image FromSurface(SDL_Surface *surface) {
+  Image image;
+  image.width = surface->w;
+  image.height = surface->h;
+  image.rgb.resize((size_t)surface->w * surface->h * 3);
+  SDL_LockSurface(surface);
+  auto out = image.rgb.data();
+  for (int y = 0; y < surface->h; ++y) {
+    auto row = (const Uint32 *)((const Uint8 *)surface->pixels +
+                                y * surface->pitch);
+    for (int x = 0; x < surface->w; ++x) {
+      SDL_GetRGB(row[x], surface->format, out, out + 1, out + 2);
+      out += 3;
+    }
+  }
+  SDL_UnlockSurface(surface);
+  return image;
+}
+
+bool WritePpm(const std::string &path, const Image &image) {
+  auto f = fopen(path.c_str(), "wb");
+  if (!f) {
+    return false;
+  }
+  fprintf(f, "P6\n%d %d\n255\n", image.width, image.height);
+  fwrite(image.rgb.data(), 1, image.rgb.size(), f);
+  return fclose(f) == 0;
+}
+
+// the next header number, skipping whitespace and comments
+bool ReadPpmNumber(FILE *f, int *value) {
+  int ch;
+  while ((ch = fgetc(f)) != EOF) {
+    if (ch == '#') {
+      while ((ch = fgetc(f)) != EOF && ch != '\n') {
+      }
+    } else if (ch < '0' || ch > '9') {
+      continue;
+    } else {
+      *value = 0;
+      do {
+        *value = *value * 10 + (ch - '0');
+      } while ((ch = fgetc(f)) >= '0' && ch <= '9');
+      // ch is the single whitespace that ends the header number
+      return true;
+    }
+  }
+  return false;
+}
+
+bool ReadPpm(const std::string &path, Image *image) {
+  auto f = fopen(path.c_str(), "rb");
+  if (!f) {
+    return false;
+  }
+  char magic[2];
+  int maxval = 0;
+  bool ok = fread(magic, 1, 2, f) == 2 && magic[0] == 'P' &&
+            magic[1] == '6' && ReadPpmNumber(f, &image->width) &&
+            ReadPpmNumber(f, &image->height) && ReadPpmNumber(f, &maxval) &&
+            maxval == 255 && image->width > 0 && image->height > 0;
+  if (ok) {
+    image->rgb.resize((size_t)image->width * image->height * 3);
+    ok = fread(image->rgb.data(), 1, image->rgb.size(), f) ==
+         image->rgb.size();
+  }
+  fclose(f);
+  return ok;
+}
+
+struct Difference {
+  long pixels = 0;
+  int max_delta = 0;
+  // differing pixels red over a dimmed actual image
+  Image image;
+};
+
+Difference Compare(const Image &actual, const Image &golden, int tolerance) {
+  Difference diff;
+  diff.image = actual;
+  for (size_t i = 0; i < actual.rgb.size(); i += 3) {
+    int delta = 0;
+    for (int c = 0; c < 3; ++c) {
+      delta = std::max(delta, abs(actual.rgb[i + c] - golden.rgb[i + c]));
+    }
+    diff.max_delta = std::max(diff.max_delta, delta);
+    auto px = &diff.image.rgb[i];
+    if (delta > tolerance) {
+      ++diff.pixels;
+      px[0] = 255;
+      px[1] = 0;
+      px[2] = 0;
+    } else {
+      px[0] /= 4;
+      px[1] /= 4;
+      px[2] /= 4;
+    }
+  }
+  return diff;
+}
+
+std::string Basename(const char *path) {
+  std::string name = path;
+  auto slash = name.find_last_of("/\\");
+  if (slash != std::string::npos) {
+    name.erase(0, slash + 1);
+  }
+  auto dot = name.rfind('.');
+  if (dot != std::string::npos && dot > 0) {
+    name.erase(dot);
+  }
+  return name;
+}
+
+std::shared_ptr<SDLRenderer> CreateRenderer(const Options &opt, int rows,
+                                            int cols) {
+  // the surface size depends on the font, measure it on a throwaway first
+  auto probe = SDLRenderer::CreateOffscreen(1, 1);
+  if (!probe || !probe->LoadFont(opt.font, opt.fontsize, nullptr)) {
+    return nullptr;
+  }
+  int width = cols * probe->font_metrics->max_advance;
+  int height = rows * probe->font_metrics->height + 4;
+  probe.reset();
+
+  auto renderer = SDLRenderer::CreateOffscreen(width, height);
+  if (!renderer || !renderer->LoadFont(opt.font, opt.fontsize, nullptr)) {
+    return nullptr;
+  }
+  // blinks with the clock, would make the image time dependent
+  renderer->cursor.active = false;
+  return renderer;
+}
+
+void Render(SDLRenderer &renderer, const termtk::Terminal &vterm, int rows,
+            int cols) {
+  renderer.Update();
+  renderer.SetDirty();
+  auto render_screen = renderer.BeginRender();
+  renderer.RenderScreen(rows, cols, vterm);
+  renderer.EndRender(render_screen, 0, 0);
+}
+
+enum Status { Pass, Fail, Error };
+
+Status Shoot(const char *input, const Options &opt) {
+  termtk::Recording recording;
+  if (!recording.Load(input)) {
+    fprintf(stderr, "fail to load: %s\n", input);
+    return Error;
+  }
+  int rows = recording.rows;
+  int cols = recording.cols;
+  termtk::Terminal vterm(
+      rows, cols, 0, 0, [](const char *, size_t, void *) {}, nullptr);
+  for (auto &event : recording.events) {
+    if (event.kind == termtk::Recording::Event::Resize) {
+      rows = event.rows;
+      cols = event.cols;
+      vterm.set_rows_cols(rows, cols);
+    } else {
+      vterm.input_write(event.data.data(), event.data.size());
+    }
+  }
+
+  auto renderer = CreateRenderer(opt, rows, cols);
+  if (!renderer) {
+    fprintf(stderr, "fail to create the offscreen renderer\n");
+    return Error;
+  }
+  Render(*renderer, vterm, rows, cols);
+  auto image = FromSurface(renderer->Surface());
+
+  auto name = Basename(input);
+  if (opt.iterations > 0) {
+    auto start = Clock::now();
+    for (int i = 0; i < opt.iterations; ++i) {
+      // every row again, not just the ones that changed
+      renderer->InvalidateRows();
+      Render(*renderer, vterm, rows, cols);
+    }
+    std::chrono::duration<double, std::milli> ms = Clock::now() - start;
+    printf("%s: %dx%d, %.3f ms/frame\n", name.c_str(), cols, rows,
+           ms.count() / opt.iterations);
+  }
+
+  if (opt.output && !WritePpm(opt.output, image)) {
+    fprintf(stderr, "fail to write: %s\n", opt.output);
+    return Error;
+  }
+  if (!opt.golden_dir) {
+    return Pass;
+  }
+
+  auto golden_path = std::string(opt.golden_dir) + "/" + name + ".ppm";
+  if (opt.update) {
+    if (!WritePpm(golden_path, image)) {
+      fprintf(stderr, "fail to write: %s\n", golden_path.c_str());
+      return Error;
+    }
+    printf("UPDATED %s\n", golden_path.c_str());
+    return Pass;
+  }
+
+  Image golden;
+  if (!ReadPpm(golden_path, &golden)) {
+    printf("FAIL %s: no golden %s\n", name.c_str(), golden_path.c_str());
+    return Fail;
+  }
+  if (golden.width != image.width || golden.height != image.height) {
+    printf("FAIL %s: %dx%d, golden is %dx%d\n", name.c_str(), image.width,
+           image.height, golden.width, golden.height);
+    return Fail;
+  }
+  auto diff = Compare(image, golden, opt.tolerance);
+  if (diff.pixels <= opt.max_pixels) {
+    printf("PASS %s\n", name.c_str());
+    return Pass;
+  }
+  printf("FAIL %s: %ld pixels differ, by up to %d\n", name.c_str(),
+         diff.pixels, diff.max_delta);
+  if (opt.diff_dir) {
+    auto base = std::string(opt.diff_dir) + "/" + name;
+    WritePpm(base + ".actual.ppm", image);
+    WritePpm(base + ".diff.ppm", diff.image);
+  }
+  return Fail;
+}
+
+const char help[] =
+    "termshot usage:\n"
+    "\ttermshot [option...] recording...\n"
+    "Renders each raw or asciicast recording offscreen and writes or\n"
+    "compares the final screen. Exits 0 when every golden matched.\n"
+    "Options:\n"
+    "  -h\tDisplay help text\n"
+    "  -o\tWrite the image of the single recording to a PPM file\n"
+    "  -g\tCompare with <dir>/<recording name>.ppm\n"
+    "  -u\tWrite the goldens of -g instead of comparing\n"
+    "  -d\tWrite the actual and diff images of mismatches to this directory\n"
+    "  -t\tPer channel difference still counted as equal (default 0)\n"
+    "  -p\tDiffering pixels still accepted (default 0)\n"
+    "  -i\tTime this many full redraws per recording\n"
+    "  -f\tFont used for rendering\n"
+    "  -s\tFont size used for rendering\n";
+
+int ParseArgs(int argc, char **argv, Options &opt) {
+  int option;
+  while ((option = getopt(argc, argv, "huo:g:d:t:p:i:f:s:")) != -1) {
+    switch (option) {
+    case 'o':
+      opt.output = optarg;
+      break;
+    case 'g':
+      opt.golden_dir = optarg;
+      break;
+    case 'u':
+      opt.update = true;
+      break;
+    case 'd':
+      opt.diff_dir = optarg;
+      break;
+    case 't':
+      opt.tolerance = std::max(0, (int)strtol(optarg, NULL, 10));
+      break;
+    case 'p':
+      opt.max_pixels = std::max(0L, strtol(optarg, NULL, 10));
+      break;
+    case 'i':
+      opt.iterations = std::max(0, (int)strtol(optarg, NULL, 10));
+      break;
+    case 'f':
+      opt.font = optarg;
+      break;
+    case 's':
+      opt.fontsize = (int)strtol(optarg, NULL, 10);
+      break;
+    default:
+      fputs(help, stderr);
+      return 1;
+    }
+  }
+  if (optind >= argc || (opt.output && argc - optind > 1) ||
+      (opt.update && !opt.golden_dir)) {
+    fputs(help, stderr);
+    return 1;
+  }
+  return 0;
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+  Options opt;
+  if (ParseArgs(argc, argv, opt)) {
+    return 1;
+  }
+
+  SDL_Init(SDL_INIT_EVENTS);
+  FOX_Init();
+  int failed = 0;
+  int errors = 0;
+  for (int i = optind; i < argc; ++i) {
+    switch (Shoot(argv[i], opt)) {
+    case Pass:
+      break;
+    case Fail:
+      ++failed;
+      break;
+    case Error:
+      ++errors;
+      break;
+    }
+  }
+  FOX_Exit();
+  SDL_Quit();
+
+  if (opt.golden_dir && !opt.update) {
+    printf("%d of %d matched\n", argc - optind - failed - errors,
+           argc - optind);
+  }
+  if (errors) {
+    return 2;
+  }
+  return failed ? 3 : 0;
+}
@@ -4,7 +4,6 @@
 #include <iostream>
 #include <stdexcept>
 #include <string.h>
-#include <string>
 
 #include <childprocess.h>
 #include <sdl_app.h>
@@ -16,27 +15,31 @@ auto FONT_FILE = "C:/Windows/Fonts/consola.ttf";
 auto FONT_FILE = "/usr/share/fonts/vlgothic/VL-Gothic-Regular.ttf";
 #endif
 
-static std::string cp2utf8(const std::u32string &unicode) {
-  std::string utf8;
-  for (auto &cp : unicode) {
+// utf8 of the code points of a cell, without allocating
+static const char *cell2utf8(const VTermScreenCell &cell,
+                             char (&utf8)[VTERM_MAX_CHARS_PER_CELL * 4 + 1]) {
+  auto p = utf8;
+  for (int i = 0; i < VTERM_MAX_CHARS_PER_CELL && cell.chars[i] != 0; i++) {
+    auto cp = cell.chars[i];
     if (cp <= 0x7F) {
-      utf8.push_back(cp);
+      *p++ = cp;
     } else if (cp <= 0x7FF) {
-      utf8.push_back((cp >> 6) + 192);
-      utf8.push_back((cp & 63) + 128);
+      *p++ = (cp >> 6) + 192;
+      *p++ = (cp & 63) + 128;
     } else if (0xd800 <= cp && cp <= 0xdfff) {
       throw std::runtime_error("invalid codepoint");
     } else if (cp <= 0xFFFF) {
-      utf8.push_back((cp >> 12) + 224);
-      utf8.push_back(((cp >> 6) & 63) + 128);
-      utf8.push_back((cp & 63) + 128);
+      *p++ = (cp >> 12) + 224;
+      *p++ = ((cp >> 6) & 63) + 128;
+      *p++ = (cp & 63) + 128;
     } else if (cp <= 0x10FFFF) {
-      utf8.push_back((cp >> 18) + 240);
-      utf8.push_back(((cp >> 12) & 63) + 128);
-      utf8.push_back(((cp >> 6) & 63) + 128);
-      utf8.push_back((cp & 63) + 128);
+      *p++ = (cp >> 18) + 240;
+      *p++ = ((cp >> 12) & 63) + 128;
+      *p++ = ((cp >> 6) & 63) + 128;
+      *p++ = (cp & 63) + 128;
     }
   }
+  *p = 0;
   return utf8;
 }
 
@@ -92,14 +95,10 @@ int main(int argc, char **argv) {
   auto cellSurface = [font](const VTermScreenCell &cell,
                             SDL_Color color) -> SDL_Surface * {
     // code points to utf8
-    std::u32string unicode;
-    for (int i = 0; cell.chars[i] != 0 && i < VTERM_MAX_CHARS_PER_CELL; i++) {
-      unicode.push_back(cell.chars[i]);
-    }
-    if (unicode.length() == 0) {
+    char utf8[VTERM_MAX_CHARS_PER_CELL * 4 + 1];
+    if (!*cell2utf8(cell, utf8)) {
       return nullptr;
     }
-    auto utf8 = cp2utf8(unicode);
 
     // style
     int style = TTF_STYLE_NORMAL;
@@ -115,7 +114,7 @@ int main(int argc, char **argv) {
     }
 
     TTF_SetFontStyle(font, style);
-    return TTF_RenderUTF8_Blended(font, utf8.c_str(), color);
+    return TTF_RenderUTF8_Blended(font, utf8, color);
   };
 
   auto surface_ = SDL_CreateRGBSurfaceWithFormat(
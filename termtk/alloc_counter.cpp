@@ -0,0 +1,117 @@
+#include "alloc_counter.h"
+#include <algorithm>
+#include <atomic>
+#include <new>
+#include <stdlib.h>
+
+#ifdef TERMTK_COUNT_ALLOCATIONS
+
+namespace {
+std::atomic<size_t> g_allocations{0};
+thread_local size_t t_allocations = 0;
+
+void Count() {
+  g_allocations.fetch_add(1, std::memory_order_relaxed);
+  ++t_allocations;
+}
+
+void *Allocate(size_t size) {
+  Count();
+  return malloc(size ? size : 1);
+}
+
+void *AllocateAligned(size_t size, std::align_val_t align) {
+  Count();
+  size = size ? size : 1;
+#ifdef _WIN32
+  return _aligned_malloc(size, (size_t)align);
+#else
+  void *p = nullptr;
+  auto alignment = std::max((size_t)align, sizeof(void *));
+  return posix_memalign(&p, alignment, size) == 0 ? p : nullptr;
+#endif
+}
+
+void FreeAligned(void *p) {
+#ifdef _WIN32
+  _aligned_free(p);
+#else
+  free(p);
+#endif
+}
+} // namespace
+
+void *operator new(size_t size) {
+  if (auto p = Allocate(size)) {
+    return p;
+  }
+  throw std::bad_alloc();
+}
+void *operator new[](size_t size) { return operator new(size); }
+void *operator new(size_t size, const std::nothrow_t &) noexcept {
+  return Allocate(size);
+}
+void *operator new[](size_t size, const std::nothrow_t &) noexcept {
+  return Allocate(size);
+}
+void *operator new(size_t size, std::align_val_t align) {
+  if (auto p = AllocateAligned(size, align)) {
+    return p;
+  }
+  throw std::bad_alloc();
+}
+void *operator new[](size_t size, std::align_val_t align) {
+  return operator new(size, align);
+}
+void *operator new(size_t size, std::align_val_t align,
+                   const std::nothrow_t &) noexcept {
+  return AllocateAligned(size, align);
+}
+void *operator new[](size_t size, std::align_val_t align,
+                     const std::nothrow_t &) noexcept {
+  return AllocateAligned(size, align);
+}
+
+void operator delete(void *p) noexcept { free(p); }
+void operator delete[](void *p) noexcept { free(p); }
+void operator delete(void *p, size_t) noexcept { free(p); }
+void operator delete[](void *p, size_t) noexcept { free(p); }
+void operator delete(void *p, const std::nothrow_t &) noexcept { free(p); }
+void operator delete[](void *p, const std::nothrow_t &) noexcept { free(p); }
+void operator delete(void *p, std::align_val_t) noexcept { FreeAligned(p); }
+void operator delete[](void *p, std::align_val_t) noexcept { FreeAligned(p); }
+void operator delete(void *p, size_t, std::align_val_t) noexcept {
+  FreeAligned(p);
+}
+void operator delete[](void *p, size_t, std::align_val_t) noexcept {
+  FreeAligned(p);
+}
+void operator delete(void *p, std::align_val_t,
+                     const std::nothrow_t &) noexcept {
+  FreeAligned(p);
+}
+void operator delete[](void *p, std::align_val_t,
+                       const std::nothrow_t &) noexcept {
+  FreeAligned(p);
+}
+
+namespace termtk {
+
+size_t AllocationCount() {
+  return g_allocations.load(std::memory_order_relaxed);
+}
+
+size_t ThreadAllocationCount() { return t_allocations; }
+
+} // namespace termtk
+
+#else
+
+namespace termtk {
+
+size_t AllocationCount() { return 0; }
+size_t ThreadAllocationCount() { return 0; }
+
+} // namespace termtk
+
+#endif
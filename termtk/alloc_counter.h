@@ -0,0 +1,20 @@
+#pragma once
+#include <stddef.h>
+
+namespace termtk {
+
+// Heap allocations made through operator new, counted by the replacement
+// operators in alloc_counter.cpp. They are compiled in only with
+// TERMTK_COUNT_ALLOCATIONS defined (CMake -DTERMTK_COUNT_ALLOCATIONS=ON,
+// meson -Dcount_allocations=true); otherwise the counts stay 0. malloc
+// calls from C libraries are not counted.
+#ifdef TERMTK_COUNT_ALLOCATIONS
+constexpr bool CountsAllocations = true;
+#else
+constexpr bool CountsAllocations = false;
+#endif
+size_t AllocationCount();
+// only those made by the calling thread
+size_t ThreadAllocationCount();
+
+} // namespace termtk
@@ -1,5 +1,5 @@
 #pragma once
-#include <span>
+#include "slab.h"
 #include <string>
 #include <sys/types.h>
 #include <vector>
@@ -16,14 +16,31 @@ public:
               const std::vector<std::string> &args = {},
               const char *TERM = "xterm-256color");
   bool IsClosed();
+  // exit code, 128 + signal number if killed, -1 while running
+  int ExitStatus() const;
+  // asks the OS right away instead of waiting for Read to notice the exit
+  bool HasExited();
   void Kill();
-  void NotifyTermSize(unsigned short rows, unsigned short cols);
+  // bursts (e.g. a live window drag) are coalesced, the child sees the
+  // size once it has settled, at most once per Read
+  void NotifyTermSize(unsigned short rows, unsigned short cols,
+                      unsigned short xpixel = 0, unsigned short ypixel = 0);
+  // bytes TryWrite lets pile up before it pushes back
+  static constexpr size_t WriteQueueLimit = 64 * 1024;
+
+  // queued and sent when the child is ready, never blocks or drops input
   void Write(const char *s, size_t len);
+  // like Write, but refuses if the queue would grow past WriteQueueLimit
+  bool TryWrite(const char *s, size_t len);
+  size_t QueuedBytes() const;
   static void Write(const char *s, size_t len, void *user) {
     auto self = (ChildProcess *)user;
     self->Write(s, len);
   }
-  std::span<char> Read();
+  // the next chunk of child output, shareable without copying. Waits up to
+  // timeout_ms for it; empty on timeout or when the wait ended for another
+  // reason (queued input was sent, the child exited).
+  SlabRef Read(int timeout_ms = 0);
 };
 
 } // namespace termtk
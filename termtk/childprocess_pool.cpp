@@ -0,0 +1,116 @@
+#include "childprocess_pool.h"
+#include <condition_variable>
+#include <deque>
+#include <iostream>
+#include <mutex>
+#include <thread>
+
+namespace termtk {
+
+struct ChildProcessPoolImpl {
+  size_t size_;
+  int rows_;
+  int cols_;
+  std::string prog_;
+  std::vector<std::string> args_;
+  std::string TERM_;
+
+  std::mutex mtx_;
+  std::condition_variable cv_;
+  std::deque<std::unique_ptr<ChildProcess>> ready_;
+  bool quit_ = false;
+  std::thread refill_;
+
+  ChildProcessPoolImpl(size_t size, int rows, int cols, const char *prog,
+                       const std::vector<std::string> &args, const char *TERM)
+      : size_(size), rows_(rows), cols_(cols), prog_(prog), args_(args),
+        TERM_(TERM) {
+    refill_ = std::thread([this] { Refill(); });
+  }
+
+  ~ChildProcessPoolImpl() {
+    {
+      std::lock_guard<std::mutex> lock(mtx_);
+      quit_ = true;
+    }
+    cv_.notify_one();
+    refill_.join();
+    // the idle children are killed by their destructors
+  }
+
+  std::unique_ptr<ChildProcess> Launch() {
+    auto child = std::make_unique<ChildProcess>();
+    child->Launch(rows_, cols_, prog_.c_str(), args_, TERM_.c_str());
+    return child;
+  }
+
+  void Refill() {
+    std::unique_lock<std::mutex> lock(mtx_);
+    while (!quit_) {
+      if (ready_.size() >= size_) {
+        cv_.wait(lock);
+        continue;
+      }
+      lock.unlock();
+      std::unique_ptr<ChildProcess> child;
+      try {
+        child = Launch();
+        if (child->HasExited()) {
+          // failed to exec, handing it out would end the session at once
+          std::cout << "pool: " << prog_ << " exited with "
+                    << child->ExitStatus() << std::endl;
+          child.reset();
+        }
+      } catch (const std::exception &e) {
+        std::cout << "pool: " << e.what() << std::endl;
+      }
+      lock.lock();
+      if (!child) {
+        // don't spin on a broken executable, wait for the next Acquire.
+        // quit_ may have been set while launching, its notify is gone
+        if (!quit_) {
+          cv_.wait(lock);
+        }
+        continue;
+      }
+      ready_.push_back(std::move(child));
+    }
+  }
+
+  std::unique_ptr<ChildProcess> Acquire(int rows, int cols) {
+    std::unique_ptr<ChildProcess> child;
+    {
+      std::lock_guard<std::mutex> lock(mtx_);
+      while (!ready_.empty() && !child) {
+        child = std::move(ready_.front());
+        ready_.pop_front();
+        if (child->HasExited()) {
+          child.reset();
+        }
+      }
+    }
+    cv_.notify_one();
+
+    if (!child) {
+      child = Launch();
+    }
+    if (rows != rows_ || cols != cols_) {
+      child->NotifyTermSize(rows, cols);
+    }
+    return child;
+  }
+};
+
+ChildProcessPool::ChildProcessPool(size_t size, int rows, int cols,
+                                   const char *prog,
+                                   const std::vector<std::string> &args,
+                                   const char *TERM)
+    : impl_(new ChildProcessPoolImpl(size, rows, cols, prog, args, TERM)) {}
+
+ChildProcessPool::~ChildProcessPool() { delete impl_; }
+
+std::unique_ptr<ChildProcess> ChildProcessPool::Acquire(int rows, int cols) {
+  return impl_->Acquire(rows, cols);
+}
+
+} // namespace termtk
@@ -0,0 +1,30 @@
+#pragma once
+#include "childprocess.h"
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace termtk {
+
+// Children launched ahead of time on ptys of a default size, so a new
+// session does not wait for the shell to start up (rc files and all).
+// Acquire hands out a warm child resized to the caller's grid, and a
+// background thread launches a replacement. Only worth it for hosts that
+// open sessions on demand (new tabs or windows), not for the first one.
+class ChildProcessPool {
+  struct ChildProcessPoolImpl *impl_ = nullptr;
+
+public:
+  ChildProcessPool(const ChildProcessPool &) = delete;
+  ChildProcessPool &operator=(const ChildProcessPool &) = delete;
+  ChildProcessPool(size_t size, int rows, int cols, const char *prog,
+                   const std::vector<std::string> &args = {},
+                   const char *TERM = "xterm-256color");
+  ~ChildProcessPool();
+  // launches synchronously when the pool is empty; a program that fails
+  // to start comes back exited with status 127, std::runtime_error is
+  // thrown only when no pty can be opened
+  std::unique_ptr<ChildProcess> Acquire(int rows, int cols);
+};
+
+} // namespace termtk
@@ -1,13 +1,21 @@
 #include "childprocess.h"
+#include <algorithm>
+#include <chrono>
+#include <fcntl.h>
 #include <iostream>
 #include <pty.h>
 #include <signal.h>
+#include <spawn.h>
 #include <stdexcept>
 #include <string.h>
 #include <sys/ioctl.h>
+#include <sys/syscall.h>
 #include <sys/wait.h>
+#include <trace.h>
 #include <unistd.h>
 
+extern char **environ;
+
 // static int childState = 0;
 // static void OnStopChild(int signum) { childState = 0; }
 
@@ -17,24 +25,129 @@ struct ChildProcessImpl {
   pid_t child_pid_ = 0;
   int pty_fd_ = 0;
   int status_ = 0;
-  char buf_[8192];
+  std::shared_ptr<SlabPool> slabs_ = SlabPool::Create();
+
+  // readable once the child exits, -1 where pidfd_open is missing
+  int pid_fd_ = -1;
+  bool exited_ = false;
+
+  // outbound bytes not yet accepted by the pty, sent from out_pos_ on
+  static constexpr size_t WriteChunk = 4096;
+  std::vector<char> out_;
+  size_t out_pos_ = 0;
+
+  // how long a new size has to stay unchanged before the child sees it
+  static constexpr std::chrono::milliseconds SizeSettleTime{50};
+  struct winsize size_ = {};
+  struct winsize pending_size_ = {};
+  bool size_pending_ = false;
+  std::chrono::steady_clock::time_point size_deadline_;
 
   ChildProcessImpl() {}
   ~ChildProcessImpl() {
-    std::cout << "Process exit status: " << status_ << std::endl;
-    kill(child_pid_, SIGKILL);
-    pid_t wpid;
-    int wstatus;
-    do {
-      wpid = waitpid(child_pid_, &wstatus, WUNTRACED | WCONTINUED);
-      if (wpid == -1)
-        break;
-    } while (!WIFEXITED(wstatus) && !WIFSIGNALED(wstatus));
-    child_pid_ = wpid;
+    std::cout << "Process exit status: " << ExitStatus() << std::endl;
+    if (child_pid_ > 0 && !exited_) {
+      kill(child_pid_, SIGKILL);
+      pid_t wpid;
+      int wstatus;
+      do {
+        wpid = waitpid(child_pid_, &wstatus, WUNTRACED | WCONTINUED);
+        if (wpid == -1)
+          break;
+      } while (!WIFEXITED(wstatus) && !WIFSIGNALED(wstatus));
+      child_pid_ = wpid;
+    }
+    if (pid_fd_ >= 0) {
+      close(pid_fd_);
+    }
+    if (pty_fd_ > 0) {
+      close(pty_fd_);
+    }
   }
   void Launch(int rows, int cols, const char *prog,
               const std::vector<std::string> &args, const char *TERM) {
     struct winsize win = {(unsigned short)rows, (unsigned short)cols, 0, 0};
+    size_ = win;
+#ifdef POSIX_SPAWN_SETSID
+    Spawn(win, prog, args, TERM);
+#else
+    ForkPty(win, prog, args, TERM);
+#endif
+
+    // the UI thread must never block on the child
+    fcntl(pty_fd_, F_SETFL, fcntl(pty_fd_, F_GETFL) | O_NONBLOCK);
+#ifdef SYS_pidfd_open
+    if (exited_) {
+      return;
+    }
+    pid_fd_ = (int)syscall(SYS_pidfd_open, child_pid_, 0);
+    if (pid_fd_ >= 0) {
+      fcntl(pid_fd_, F_SETFD, FD_CLOEXEC);
+    }
+#endif
+  }
+
+#ifdef POSIX_SPAWN_SETSID
+  // posix_spawn does not copy the page tables of the parent, the launch
+  // cost does not grow with the memory the terminal holds
+  void Spawn(struct winsize &win, const char *prog,
+             const std::vector<std::string> &args, const char *TERM) {
+    pty_fd_ = posix_openpt(O_RDWR | O_NOCTTY | O_CLOEXEC);
+    if (pty_fd_ < 0) {
+      throw std::runtime_error("posix_openpt failed");
+    }
+    char slave[64];
+    if (grantpt(pty_fd_) != 0 || unlockpt(pty_fd_) != 0 ||
+        ptsname_r(pty_fd_, slave, sizeof(slave)) != 0) {
+      throw std::runtime_error("pty setup failed");
+    }
+    ioctl(pty_fd_, TIOCSWINSZ, &win);
+
+    std::vector<char *> argv;
+    argv.push_back(const_cast<char *>(prog));
+    for (auto &arg : args) {
+      argv.push_back(const_cast<char *>(arg.c_str()));
+    }
+    argv.push_back(nullptr);
+
+    std::string term = std::string("TERM=") + TERM;
+    std::vector<char *> envp;
+    for (auto env = environ; *env; ++env) {
+      if (strncmp(*env, "TERM=", 5) != 0) {
+        envp.push_back(*env);
+      }
+    }
+    envp.push_back(term.data());
+    envp.push_back(nullptr);
+
+    // a new session whose first opened tty, the slave, becomes the
+    // controlling terminal
+    posix_spawnattr_t attr;
+    posix_spawnattr_init(&attr);
+    posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETSID);
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_addopen(&actions, 0, slave, O_RDWR, 0);
+    posix_spawn_file_actions_adddup2(&actions, 0, 1);
+    posix_spawn_file_actions_adddup2(&actions, 0, 2);
+
+    auto result = posix_spawnp(&child_pid_, prog, &actions, &attr,
+                               argv.data(), envp.data());
+    posix_spawn_file_actions_destroy(&actions);
+    posix_spawnattr_destroy(&attr);
+    if (result != 0) {
+      // like a forked child whose exec failed: the session ends at once
+      // with the shell's "command not found" status
+      std::cout << "fail to launch: " << prog << " => " << strerror(result)
+                << std::endl;
+      child_pid_ = 0;
+      status_ = 127 << 8;
+      exited_ = true;
+    }
+  }
+#else
+  void ForkPty(struct winsize &win, const char *prog,
+               const std::vector<std::string> &args, const char *TERM) {
     child_pid_ = forkpty(&pty_fd_, NULL, NULL, &win);
     if (child_pid_ < 0) {
       throw std::runtime_error("forkpty failed");
@@ -48,55 +161,147 @@ struct ChildProcessImpl {
       }
       argv[args.size() + 1] = NULL;
       if (execvp(prog, argv) < 0)
-        exit(-1);
-      // child
-      // execvp(exec, argv);
-      // exit(0);
-    } else {
-      // parent
-      // struct sigaction action = {0};
-      // action.sa_handler = OnStopChild;
-      // action.sa_flags = 0;
-      // sigemptyset(&action.sa_mask);
-      // sigaction(SIGCHLD, &action, NULL);
-      // childState = 1;
+        _exit(127);
+    }
+  }
+#endif
+
+  void Reap() {
+    if (!exited_ && ::waitpid(child_pid_, &status_, WNOHANG) == child_pid_) {
+      exited_ = true;
     }
   }
 
   bool IsClosed() {
-    auto done_pid = ::waitpid(child_pid_, &status_, WNOHANG);
-    return child_pid_ == done_pid;
+    if (pid_fd_ < 0) {
+      // old kernel, poll
+      Reap();
+    }
+    return exited_;
+  }
+
+  int ExitStatus() const {
+    if (!exited_) {
+      return -1;
+    }
+    if (WIFSIGNALED(status_)) {
+      return 128 + WTERMSIG(status_);
+    }
+    return WEXITSTATUS(status_);
   }
 
   void Kill() {
+    if (child_pid_ <= 0) {
+      return;
+    }
     if (::kill(child_pid_, SIGKILL) != 0) {
       std::cout << "fail to kill: " << child_pid_ << " => " << errno
                 << std::endl;
     }
   }
 
-  void Write(const char *buf, size_t size) { write(pty_fd_, buf, size); }
-  // void ChildProcess::Write(const char *s, size_t len) {
-  //   ::write(pty_fd_, s, len);
-  // }
+  void NotifyTermSize(unsigned short rows, unsigned short cols,
+                      unsigned short xpixel, unsigned short ypixel) {
+    pending_size_ = {rows, cols, xpixel, ypixel};
+    size_pending_ = true;
+    size_deadline_ = std::chrono::steady_clock::now() + SizeSettleTime;
+  }
+
+  void FlushTermSize() {
+    if (!size_pending_ ||
+        std::chrono::steady_clock::now() < size_deadline_) {
+      return;
+    }
+    size_pending_ = false;
+    if (memcmp(&pending_size_, &size_, sizeof(size_)) == 0) {
+      // dragged back to where it started
+      return;
+    }
+    // the kernel sends SIGWINCH to the foreground process group
+    if (ioctl(pty_fd_, TIOCSWINSZ, &pending_size_) != 0) {
+      std::cout << "fail to TIOCSWINSZ: " << errno << std::endl;
+      return;
+    }
+    size_ = pending_size_;
+  }
+
+  size_t QueuedBytes() const { return out_.size() - out_pos_; }
+
+  void Write(const char *buf, size_t size) {
+    out_.insert(out_.end(), buf, buf + size);
+    FlushWrites();
+  }
+
+  bool TryWrite(const char *buf, size_t size) {
+    if (QueuedBytes() + size > ChildProcess::WriteQueueLimit) {
+      FlushWrites();
+      if (QueuedBytes() + size > ChildProcess::WriteQueueLimit) {
+        return false;
+      }
+    }
+    Write(buf, size);
+    return true;
+  }
+
+  void FlushWrites() {
+    while (out_pos_ < out_.size()) {
+      auto size = std::min(out_.size() - out_pos_, WriteChunk);
+      auto written = ::write(pty_fd_, out_.data() + out_pos_, size);
+      if (written < 0) {
+        if (errno == EINTR) {
+          continue;
+        }
+        if (errno != EAGAIN && errno != EWOULDBLOCK) {
+          // the child is gone, nobody will read the rest
+          std::cout << "fail to write: " << errno << std::endl;
+          out_pos_ = out_.size();
+        }
+        break;
+      }
+      out_pos_ += written;
+    }
+    if (out_pos_ == out_.size()) {
+      out_.clear();
+      out_pos_ = 0;
+    } else if (out_pos_ > out_.size() / 2) {
+      out_.erase(out_.begin(), out_.begin() + out_pos_);
+      out_pos_ = 0;
+    }
+  }
+
+  SlabRef Read(int timeout_ms) {
+    FlushTermSize();
 
-  std::span<char> Read() {
     fd_set readfds;
     FD_ZERO(&readfds);
     FD_SET(pty_fd_, &readfds);
-    // fd_set rfds;
-    // FD_ZERO(&rfds);
-    // FD_SET(child_fd_, &rfds);
-    timeval timeout = {0, 0};
-    // struct timeval tv = {0};
-    // tv.tv_sec = 0;
-    // tv.tv_usec = 50000;
-    if (select(pty_fd_ + 1, &readfds, NULL, NULL, &timeout) > 0) {
-      auto size = ::read(pty_fd_, buf_, sizeof(buf_));
+    fd_set writefds;
+    FD_ZERO(&writefds);
+    if (QueuedBytes()) {
+      FD_SET(pty_fd_, &writefds);
+    }
+    int nfds = pty_fd_ + 1;
+    if (pid_fd_ >= 0 && !exited_) {
+      FD_SET(pid_fd_, &readfds);
+      nfds = std::max(nfds, pid_fd_ + 1);
+    }
+    timeval timeout = {timeout_ms / 1000, (timeout_ms % 1000) * 1000};
+    if (select(nfds, &readfds, &writefds, NULL, &timeout) <= 0) {
+      return {};
+    }
+    if (pid_fd_ >= 0 && FD_ISSET(pid_fd_, &readfds)) {
+      Reap();
+    }
+    if (FD_ISSET(pty_fd_, &writefds)) {
+      FlushWrites();
+    }
+    if (FD_ISSET(pty_fd_, &readfds)) {
+      // straight into the slab the consumers will share
+      auto slab = slabs_->Get();
+      auto size = ::read(pty_fd_, slab.mutable_data(), Slab::Capacity);
       if (size > 0) {
-        // TODO: write to vterm
-        // input_write(buf, size);
-        return {buf_, buf_ + size};
+        slab.set_size(size);
+        return slab;
       }
     }
     return {};
@@ -115,14 +320,28 @@ void ChildProcess::Launch(int rows, int cols, const char *prog,
 
 // bool ChildProcess::Closed() const { return childState == 0; }
 bool ChildProcess::IsClosed() { return impl_->IsClosed(); }
+int ChildProcess::ExitStatus() const { return impl_->ExitStatus(); }
+bool ChildProcess::HasExited() {
+  impl_->Reap();
+  return impl_->exited_;
+}
 void ChildProcess::Kill() { impl_->Kill(); }
-void ChildProcess::NotifyTermSize(unsigned short rows, unsigned short cols) {
-  throw std::runtime_error("not implemented");
+void ChildProcess::NotifyTermSize(unsigned short rows, unsigned short cols,
+                                  unsigned short xpixel,
+                                  unsigned short ypixel) {
+  impl_->NotifyTermSize(rows, cols, xpixel, ypixel);
 }
 
 void ChildProcess::Write(const char *buf, size_t size) {
   impl_->Write(buf, size);
 }
-std::span<char> ChildProcess::Read() { return impl_->Read(); }
+bool ChildProcess::TryWrite(const char *buf, size_t size) {
+  return impl_->TryWrite(buf, size);
+}
+size_t ChildProcess::QueuedBytes() const { return impl_->QueuedBytes(); }
+SlabRef ChildProcess::Read(int timeout_ms) {
+  TRACE_SCOPE("ChildProcess::Read");
+  return impl_->Read(timeout_ms);
+}
 
 } // namespace termtk
\ No newline at end of file
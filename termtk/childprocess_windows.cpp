@@ -1,12 +1,15 @@
 #include "childprocess.h"
 #include <Windows.h>
 #include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
 #include <iostream>
 #include <mutex>
 #include <process.h>
-#include <span>
 #include <stdexcept>
 #include <string.h>
+#include <trace.h>
 #include <winerror.h>
 
 // Forward declarations
@@ -22,9 +25,11 @@ struct ChildProcessImpl {
   STARTUPINFOEXA startupInfo_{};
   PROCESS_INFORMATION piClient_{};
 
-  std::vector<char> buffer_;
+  // filled by the listener thread, in arrival order
+  std::shared_ptr<SlabPool> slabs_ = SlabPool::Create();
+  std::deque<SlabRef> ready_;
   std::mutex mtx_;
-  std::vector<char> tmp_;
+  std::condition_variable ready_cv_;
 
   void Shutdown() {
     // Now safe to clean-up client app's process-info & thread
@@ -135,23 +140,30 @@ struct ChildProcessImpl {
     return SUCCEEDED(hr);
   }
 
-  void Enqueue(const char *buf, DWORD len) {
-    if (len == 0) {
+  void Enqueue(SlabRef slab) {
+    if (slab.empty()) {
       return;
     }
 
-    std::lock_guard<std::mutex> lock(mtx_);
-    auto size = buffer_.size();
-    buffer_.resize(size + len);
-    memcpy(buffer_.data() + size, buf, len);
-
-    // std::cout << "Enqueue>>" << std::string_view(buf, len) << std::endl;
+    {
+      std::lock_guard<std::mutex> lock(mtx_);
+      ready_.push_back(std::move(slab));
+    }
+    ready_cv_.notify_one();
   }
 
-  auto Dequeue(std::vector<char> &buffer) {
-    std::lock_guard<std::mutex> lock(mtx_);
-    std::swap(buffer, buffer_);
-    buffer_.clear();
+  SlabRef Dequeue(int timeout_ms) {
+    std::unique_lock<std::mutex> lock(mtx_);
+    if (ready_.empty() && timeout_ms > 0) {
+      ready_cv_.wait_for(lock, std::chrono::milliseconds(timeout_ms),
+                         [this] { return !ready_.empty(); });
+    }
+    if (ready_.empty()) {
+      return {};
+    }
+    auto slab = std::move(ready_.front());
+    ready_.pop_front();
+    return slab;
   }
 
   bool IsClosed() {
@@ -159,6 +171,15 @@ struct ChildProcessImpl {
     return result == WAIT_OBJECT_0;
   }
 
+  int ExitStatus() const {
+    DWORD code;
+    if (!GetExitCodeProcess(piClient_.hProcess, &code) ||
+        code == STILL_ACTIVE) {
+      return -1;
+    }
+    return (int)code;
+  }
+
   void Kill() { TerminateProcess(piClient_.hProcess, 9); }
 
   void Write(const char *buf, size_t size) {
@@ -179,10 +200,7 @@ struct ChildProcessImpl {
     ResizePseudoConsole(hpc_, size);
   }
 
-  std::span<char> Read() {
-    Dequeue(tmp_);
-    return {tmp_.begin(), tmp_.end()};
-  }
+  SlabRef Read(int timeout_ms) { return Dequeue(timeout_ms); }
 };
 
 static void __cdecl PipeListener(LPVOID p) {
@@ -190,22 +208,22 @@ static void __cdecl PipeListener(LPVOID p) {
   HANDLE hPipe{impl->hPipeIn_};
   HANDLE hConsole{GetStdHandle(STD_OUTPUT_HANDLE)};
 
-  const DWORD BUFF_SIZE{512};
-  char szBuffer[BUFF_SIZE]{};
-
   DWORD dwBytesWritten{};
   DWORD dwBytesRead{};
   BOOL fRead{FALSE};
   do {
     // Read from the pipe
-    fRead = ReadFile(hPipe, szBuffer, BUFF_SIZE, &dwBytesRead, NULL);
+    auto slab = impl->slabs_->Get();
+    fRead = ReadFile(hPipe, slab.mutable_data(), (DWORD)Slab::Capacity,
+                     &dwBytesRead, NULL);
+    slab.set_size(fRead ? dwBytesRead : 0);
 
     // Write received text to the Console
     // Note: Write to the Console using WriteFile(hConsole...), not
     // printf()/puts() to prevent partially-read VT sequences from corrupting
     // output
     // WriteFile(hConsole, szBuffer, dwBytesRead, &dwBytesWritten, NULL);
-    impl->Enqueue(szBuffer, dwBytesRead);
+    impl->Enqueue(std::move(slab));
 
   } while (fRead && dwBytesRead >= 0);
 
@@ -241,13 +259,27 @@ void ChildProcess::Launch(int rows, int cols, const char *prog,
 }
 
 bool ChildProcess::IsClosed() { return impl_->IsClosed(); }
+int ChildProcess::ExitStatus() const { return impl_->ExitStatus(); }
+bool ChildProcess::HasExited() { return impl_->IsClosed(); }
 void ChildProcess::Kill() { impl_->Kill(); }
 void ChildProcess::Write(const char *buf, size_t size) {
   impl_->Write(buf, size);
 }
-void ChildProcess::NotifyTermSize(unsigned short rows, unsigned short cols) {
+// the pipe write blocks until conhost takes the bytes, nothing is queued
+bool ChildProcess::TryWrite(const char *buf, size_t size) {
+  impl_->Write(buf, size);
+  return true;
+}
+size_t ChildProcess::QueuedBytes() const { return 0; }
+void ChildProcess::NotifyTermSize(unsigned short rows, unsigned short cols,
+                                  unsigned short xpixel,
+                                  unsigned short ypixel) {
+  // the pseudo console has no notion of pixels
   impl_->NotifyTermSize(rows, cols);
 }
-std::span<char> ChildProcess::Read() { return impl_->Read(); }
+SlabRef ChildProcess::Read(int timeout_ms) {
+  TRACE_SCOPE("ChildProcess::Read");
+  return impl_->Read(timeout_ms);
+}
 
 } // namespace termtk
\ No newline at end of file
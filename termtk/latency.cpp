@@ -0,0 +1,95 @@
+#include "latency.h"
+#include <algorithm>
+
+namespace termtk {
+
+LatencyTracker::~LatencyTracker() {
+  if (log_) {
+    fclose(log_);
+  }
+}
+
+bool LatencyTracker::OpenLog(const char *path) {
+  log_ = fopen(path, "w");
+  if (!log_) {
+    return false;
+  }
+  fputs("write_ms,echo_ms,parse_ms,present_ms,total_ms\n", log_);
+  return true;
+}
+
+void LatencyTracker::Begin(Clock::time_point input_time) {
+  if (pending_ && Clock::now() - marks_[Input] < Timeout) {
+    return;
+  }
+  pending_ = true;
+  marks_[Input] = input_time;
+  reached_ = Input;
+}
+
+void LatencyTracker::Mark(Stage stage) {
+  if (!pending_ || reached_ != stage - 1) {
+    return;
+  }
+  auto now = Clock::now();
+  if (now - marks_[Input] >= Timeout) {
+    pending_ = false;
+    return;
+  }
+  marks_[stage] = now;
+  reached_ = stage;
+  if (stage != Present) {
+    return;
+  }
+
+  pending_ = false;
+  Sample sample = {};
+  for (int i = Write; i < StageCount; ++i) {
+    sample.stage[i] = std::chrono::duration<double, std::milli>(
+                          marks_[i] - marks_[i - 1])
+                          .count();
+  }
+  sample.total = std::chrono::duration<double, std::milli>(marks_[Present] -
+                                                           marks_[Input])
+                     .count();
+  if (samples_.size() < MaxSamples) {
+    samples_.push_back(sample);
+  } else {
+    samples_[next_] = sample;
+  }
+  next_ = (next_ + 1) % MaxSamples;
+
+  if (log_) {
+    fprintf(log_, "%.3f,%.3f,%.3f,%.3f,%.3f\n", sample.stage[Write],
+            sample.stage[Echo], sample.stage[Parse], sample.stage[Present],
+            sample.total);
+    fflush(log_);
+  }
+}
+
+LatencyTracker::Summary LatencyTracker::Summarize() const {
+  Summary summary;
+  summary.samples = samples_.size();
+  if (samples_.empty()) {
+    return summary;
+  }
+
+  std::vector<double> totals;
+  totals.reserve(samples_.size());
+  for (auto &sample : samples_) {
+    totals.push_back(sample.total);
+    for (int i = Write; i < StageCount; ++i) {
+      summary.stage[i] += sample.stage[i] / samples_.size();
+    }
+  }
+  auto percentile = [&totals](double p) {
+    auto n = std::min(totals.size() - 1, (size_t)(p * totals.size()));
+    std::nth_element(totals.begin(), totals.begin() + n, totals.end());
+    return totals[n];
+  };
+  summary.p50 = percentile(0.50);
+  summary.p99 = percentile(0.99);
+  return summary;
+}
+
+} // namespace termtk
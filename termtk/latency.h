@@ -0,0 +1,56 @@
+#pragma once
+#include <chrono>
+#include <stddef.h>
+#include <stdio.h>
+#include <vector>
+
+namespace termtk {
+
+// Follows a keypress through the pipeline to the frame that shows its
+// echo: input event, write to the child, echo read back, parsed by the
+// terminal, presented. One sample is in flight at a time; keys typed
+// while it is pending are covered by it, since the user waits on the
+// oldest one.
+class LatencyTracker {
+public:
+  using Clock = std::chrono::steady_clock;
+  enum Stage { Input, Write, Echo, Parse, Present, StageCount };
+  static constexpr size_t MaxSamples = 1024;
+
+  struct Summary {
+    size_t samples = 0;
+    // end to end, ms
+    double p50 = 0;
+    double p99 = 0;
+    // mean ms from the previous stage to this one
+    double stage[StageCount] = {};
+  };
+
+  ~LatencyTracker();
+  // CSV with one line per completed sample
+  bool OpenLog(const char *path);
+  void Begin(Clock::time_point input_time);
+  // records now for stage if the previous stage of the pending sample
+  // was already reached
+  void Mark(Stage stage);
+  bool Pending() const { return pending_; }
+  Summary Summarize() const;
+
+private:
+  // a key the child never echoes must not block the tracker forever
+  static constexpr std::chrono::seconds Timeout{1};
+
+  bool pending_ = false;
+  Clock::time_point marks_[StageCount];
+  int reached_ = -1;
+  // ring of completed samples, ms per stage
+  struct Sample {
+    double stage[StageCount];
+    double total;
+  };
+  std::vector<Sample> samples_;
+  size_t next_ = 0;
+  FILE *log_ = nullptr;
+};
+
+} // namespace termtk
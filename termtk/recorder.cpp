@@ -0,0 +1,228 @@
+#include "recorder.h"
+#include <chrono>
+#include <condition_variable>
+#include <ctime>
+#include <iostream>
+#include <mutex>
+#include <stdio.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace termtk {
+
+namespace {
+
+// length of the UTF-8 sequence starting with lead, 0 if lead is invalid
+int SequenceLength(unsigned char lead) {
+  if (lead < 0x80) {
+    return 1;
+  } else if (lead >= 0xc2 && lead <= 0xdf) {
+    return 2;
+  } else if (lead >= 0xe0 && lead <= 0xef) {
+    return 3;
+  } else if (lead >= 0xf0 && lead <= 0xf4) {
+    return 4;
+  }
+  return 0;
+}
+
+// appends bytes as the body of a JSON string. Invalid UTF-8 becomes
+// U+FFFD, an incomplete sequence at the end is left in carry.
+void AppendJsonString(std::string &out, std::string &carry, const char *data,
+                      size_t size) {
+  std::string bytes;
+  if (!carry.empty()) {
+    bytes.swap(carry);
+    bytes.append(data, size);
+    data = bytes.data();
+    size = bytes.size();
+  }
+
+  static const char hex[] = "0123456789abcdef";
+  size_t i = 0;
+  while (i < size) {
+    auto ch = (unsigned char)data[i];
+    int len = SequenceLength(ch);
+    if (len == 1) {
+      if (ch == '"' || ch == '\\') {
+        out += '\\';
+        out += (char)ch;
+      } else if (ch < 0x20) {
+        out += "\\u00";
+        out += hex[ch >> 4];
+        out += hex[ch & 0xf];
+      } else {
+        out += (char)ch;
+      }
+      ++i;
+      continue;
+    }
+    if (len && i + len > size) {
+      // continued in the next chunk
+      carry.assign(data + i, size - i);
+      return;
+    }
+    bool valid = len != 0;
+    for (int j = 1; valid && j < len; ++j) {
+      valid = ((unsigned char)data[i + j] & 0xc0) == 0x80;
+    }
+    if (valid) {
+      // overlong forms, surrogates and code points past U+10FFFF
+      auto next = (unsigned char)data[i + 1];
+      valid = !(ch == 0xe0 && next < 0xa0) && !(ch == 0xed && next >= 0xa0) &&
+              !(ch == 0xf0 && next < 0x90) && !(ch == 0xf4 && next >= 0x90);
+    }
+    if (!valid) {
+      out += "\\ufffd";
+      ++i;
+      continue;
+    }
+    out.append(data + i, len);
+    i += len;
+  }
+}
+
+} // namespace
+
+struct SessionRecorderImpl {
+  struct Event {
+    double time;
+    SlabRef slab;
+    // resize events carry no slab
+    int rows;
+    int cols;
+  };
+
+  FILE *file_ = nullptr;
+  std::chrono::steady_clock::time_point start_;
+  std::mutex mtx_;
+  std::condition_variable cv_;
+  std::vector<Event> queue_;
+  bool quit_ = false;
+  size_t dropped_ = 0;
+  std::thread writer_;
+
+  ~SessionRecorderImpl() { Close(); }
+
+  bool Open(const char *path, int rows, int cols, const char *TERM) {
+    Close();
+    file_ = fopen(path, "wb");
+    if (!file_) {
+      return false;
+    }
+    fprintf(file_,
+            "{\"version\": 2, \"width\": %d, \"height\": %d, "
+            "\"timestamp\": %lld, \"env\": {\"TERM\": \"%s\"}}\n",
+            cols, rows, (long long)time(nullptr), TERM);
+    start_ = std::chrono::steady_clock::now();
+    quit_ = false;
+    dropped_ = 0;
+    writer_ = std::thread([this] { Write(); });
+    return true;
+  }
+
+  void Close() {
+    if (!file_) {
+      return;
+    }
+    {
+      std::lock_guard<std::mutex> lock(mtx_);
+      quit_ = true;
+    }
+    cv_.notify_one();
+    writer_.join();
+    fclose(file_);
+    file_ = nullptr;
+    if (dropped_) {
+      std::cout << "recorder dropped " << dropped_ << " chunks" << std::endl;
+    }
+  }
+
+  double Now() const {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                         start_)
+        .count();
+  }
+
+  void Enqueue(Event &&event) {
+    {
+      std::lock_guard<std::mutex> lock(mtx_);
+      if (queue_.size() >= SessionRecorder::QueueLimit) {
+        ++dropped_;
+        return;
+      }
+      queue_.push_back(std::move(event));
+    }
+    cv_.notify_one();
+  }
+
+  void Write() {
+    std::vector<Event> events;
+    std::string line;
+    std::string carry;
+    std::unique_lock<std::mutex> lock(mtx_);
+    while (true) {
+      cv_.wait(lock, [this] { return quit_ || !queue_.empty(); });
+      if (queue_.empty() && quit_) {
+        break;
+      }
+      std::swap(events, queue_);
+      lock.unlock();
+
+      for (auto &event : events) {
+        char head[64];
+        if (event.slab.empty()) {
+          snprintf(head, sizeof(head), "[%.6f, \"r\", \"%dx%d\"]\n",
+                   event.time, event.cols, event.rows);
+          fputs(head, file_);
+          continue;
+        }
+        snprintf(head, sizeof(head), "[%.6f, \"o\", \"", event.time);
+        line = head;
+        auto head_size = line.size();
+        AppendJsonString(line, carry, event.slab.data(), event.slab.size());
+        if (line.size() == head_size) {
+          // all of it went to carry, it is written with the next chunk
+          continue;
+        }
+        line += "\"]\n";
+        fwrite(line.data(), 1, line.size(), file_);
+      }
+      // hand the slabs back before waiting again
+      events.clear();
+      fflush(file_);
+
+      lock.lock();
+    }
+  }
+};
+
+SessionRecorder::SessionRecorder() : impl_(new SessionRecorderImpl) {}
+SessionRecorder::~SessionRecorder() { delete impl_; }
+
+bool SessionRecorder::Open(const char *path, int rows, int cols,
+                           const char *TERM) {
+  return impl_->Open(path, rows, cols, TERM);
+}
+void SessionRecorder::Close() { impl_->Close(); }
+bool SessionRecorder::IsOpen() const { return impl_->file_ != nullptr; }
+
+void SessionRecorder::Output(const SlabRef &slab) {
+  if (impl_->file_ && !slab.empty()) {
+    impl_->Enqueue({impl_->Now(), slab, 0, 0});
+  }
+}
+
+void SessionRecorder::Resize(int rows, int cols) {
+  if (impl_->file_) {
+    impl_->Enqueue({impl_->Now(), {}, rows, cols});
+  }
+}
+
+size_t SessionRecorder::Dropped() const {
+  std::lock_guard<std::mutex> lock(impl_->mtx_);
+  return impl_->dropped_;
+}
+
+} // namespace termtk
@@ -0,0 +1,31 @@
+#pragma once
+#include "slab.h"
+#include <stddef.h>
+
+namespace termtk {
+
+// Records child output to an asciicast v2 file. The terminal thread only
+// timestamps and queues slab references; a writer thread does the JSON
+// encoding and the file IO. When the writer falls behind by more than
+// QueueLimit chunks, new chunks are dropped and counted rather than ever
+// blocking the caller.
+class SessionRecorder {
+  struct SessionRecorderImpl *impl_ = nullptr;
+
+public:
+  static constexpr size_t QueueLimit = 4096;
+
+  SessionRecorder(const SessionRecorder &) = delete;
+  SessionRecorder &operator=(const SessionRecorder &) = delete;
+  SessionRecorder();
+  ~SessionRecorder();
+  bool Open(const char *path, int rows, int cols,
+            const char *TERM = "xterm-256color");
+  void Close();
+  bool IsOpen() const;
+  void Output(const SlabRef &slab);
+  void Resize(int rows, int cols);
+  size_t Dropped() const;
+};
+
+} // namespace termtk
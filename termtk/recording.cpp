@@ -0,0 +1,180 @@
+#include "recording.h"
+#include <fstream>
+#include <iostream>
+#include <stdlib.h>
+#include <string.h>
+
+namespace termtk {
+
+namespace {
+
+// raw files are cut into chunks of about one pty read
+constexpr size_t RawChunk = 16 * 1024;
+
+void AppendUtf8(std::string &out, unsigned long cp) {
+  if (cp < 0x80) {
+    out += (char)cp;
+  } else if (cp < 0x800) {
+    out += (char)(0xc0 | cp >> 6);
+    out += (char)(0x80 | (cp & 0x3f));
+  } else if (cp < 0x10000) {
+    out += (char)(0xe0 | cp >> 12);
+    out += (char)(0x80 | (cp >> 6 & 0x3f));
+    out += (char)(0x80 | (cp & 0x3f));
+  } else {
+    out += (char)(0xf0 | cp >> 18);
+    out += (char)(0x80 | (cp >> 12 & 0x3f));
+    out += (char)(0x80 | (cp >> 6 & 0x3f));
+    out += (char)(0x80 | (cp & 0x3f));
+  }
+}
+
+// decodes the JSON string starting at the opening quote p, returns the
+// position after the closing quote or nullptr
+const char *ParseString(const char *p, std::string &out) {
+  if (*p != '"') {
+    return nullptr;
+  }
+  for (++p; *p && *p != '"'; ++p) {
+    if (*p != '\\') {
+      out += *p;
+      continue;
+    }
+    switch (*++p) {
+    case 'b':
+      out += '\b';
+      break;
+    case 'f':
+      out += '\f';
+      break;
+    case 'n':
+      out += '\n';
+      break;
+    case 'r':
+      out += '\r';
+      break;
+    case 't':
+      out += '\t';
+      break;
+    case 'u': {
+      char hex[5] = {};
+      if (strlen(p + 1) < 4) {
+        return nullptr;
+      }
+      memcpy(hex, p + 1, 4);
+      unsigned long cp = strtoul(hex, nullptr, 16);
+      p += 4;
+      if (cp >= 0xd800 && cp < 0xdc00 && p[1] == '\\' && p[2] == 'u' &&
+          strlen(p + 3) >= 4) {
+        memcpy(hex, p + 3, 4);
+        unsigned long low = strtoul(hex, nullptr, 16);
+        if (low >= 0xdc00 && low < 0xe000) {
+          cp = 0x10000 + ((cp - 0xd800) << 10) + (low - 0xdc00);
+          p += 6;
+        }
+      }
+      AppendUtf8(out, cp);
+      break;
+    }
+    case '\0':
+      return nullptr;
+    default:
+      // \" \\ \/
+      out += *p;
+      break;
+    }
+  }
+  return *p == '"' ? p + 1 : nullptr;
+}
+
+const char *SkipSpace(const char *p) {
+  while (*p == ' ' || *p == '\t' || *p == ',') {
+    ++p;
+  }
+  return p;
+}
+
+// [time, "o", "data"] or [time, "r", "COLSxROWS"]
+bool ParseEvent(const std::string &line, Recording::Event &event) {
+  auto p = SkipSpace(line.c_str());
+  if (*p++ != '[') {
+    return false;
+  }
+  char *end;
+  event.time = strtod(p, &end);
+  std::string code;
+  p = ParseString(SkipSpace(end), code);
+  if (!p) {
+    return false;
+  }
+  std::string data;
+  if (!ParseString(SkipSpace(p), data)) {
+    return false;
+  }
+  if (code == "o") {
+    // nothing to replay in an empty chunk
+    event.kind = Recording::Event::Output;
+    event.data = std::move(data);
+    return !event.data.empty();
+  }
+  if (code == "r") {
+    event.kind = Recording::Event::Resize;
+    return sscanf(data.c_str(), "%dx%d", &event.cols, &event.rows) == 2 &&
+           event.rows > 0 && event.cols > 0;
+  }
+  // input and marker events are not replayed
+  return false;
+}
+
+int HeaderInt(const std::string &header, const char *key, int fallback) {
+  auto found = header.find(key);
+  if (found == std::string::npos) {
+    return fallback;
+  }
+  found = header.find(':', found);
+  if (found == std::string::npos) {
+    return fallback;
+  }
+  return (int)strtol(header.c_str() + found + 1, nullptr, 10);
+}
+
+} // namespace
+
+bool Recording::Load(const char *path) {
+  std::ifstream file(path, std::ios::binary);
+  if (!file) {
+    return false;
+  }
+  events.clear();
+  bytes = 0;
+
+  std::string line;
+  std::getline(file, line);
+  bool asciicast = line.starts_with("{") &&
+                   line.find("\"version\"") != std::string::npos;
+  if (!asciicast) {
+    file.clear();
+    file.seekg(0);
+    std::vector<char> buf(RawChunk);
+    while (file.read(buf.data(), buf.size()) || file.gcount() > 0) {
+      Event event;
+      event.data.assign(buf.data(), file.gcount());
+      bytes += event.data.size();
+      events.push_back(std::move(event));
+    }
+    return true;
+  }
+
+  rows = HeaderInt(line, "\"height\"", rows);
+  cols = HeaderInt(line, "\"width\"", cols);
+  while (std::getline(file, line)) {
+    Event event;
+    if (ParseEvent(line, event)) {
+      bytes += event.data.size();
+      events.push_back(std::move(event));
+    }
+  }
+  return true;
+}
+
+} // namespace termtk
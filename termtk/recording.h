@@ -0,0 +1,32 @@
+#pragma once
+#include <stddef.h>
+#include <string>
+#include <vector>
+
+namespace termtk {
+
+// A recorded byte stream loaded up front, so replaying it measures the
+// terminal and not the file parsing. Reads asciicast v2 files as written
+// by SessionRecorder and raw dumps of pty output.
+struct Recording {
+  struct Event {
+    enum Kind { Output, Resize };
+    Kind kind = Output;
+    double time = 0;
+    // output bytes, never empty
+    std::string data;
+    // the new grid of resize events
+    int rows = 0;
+    int cols = 0;
+  };
+
+  int rows = 24;
+  int cols = 80;
+  std::vector<Event> events;
+  // total output bytes
+  size_t bytes = 0;
+
+  bool Load(const char *path);
+};
+
+} // namespace termtk
@@ -20,9 +20,13 @@ struct SDLWindowImpl {
   SDL_Surface *icon_;
   int width_ = 0;
   int height_ = 0;
+  bool visible_ = true;
+  bool exposed_ = false;
 
   SDLWindowImpl(SDL_Window *window) : window_(window) {
     SDL_GetWindowSize(window_, &width_, &height_);
+    visible_ = !(SDL_GetWindowFlags(window_) &
+                 (SDL_WINDOW_HIDDEN | SDL_WINDOW_MINIMIZED));
 
     icon_ = SDL_CreateRGBSurfaceFrom(pixels, 16, 16, 16, 16 * 2, 0x0f00, 0x00f0,
                                      0x000f, 0xf000);
@@ -40,6 +44,19 @@ SDLWindow::SDLWindow(SDL_Window *window) : impl_(new SDLWindowImpl(window)) {}
 SDLWindow::~SDLWindow() { delete impl_; }
 int SDLWindow::Width() const { return impl_->width_; }
 int SDLWindow::Height() const { return impl_->height_; }
+int SDLWindow::RefreshRate() const {
+  SDL_DisplayMode mode;
+  if (SDL_GetWindowDisplayMode(impl_->window_, &mode) != 0) {
+    return 0;
+  }
+  return mode.refresh_rate;
+}
+bool SDLWindow::Visible() const { return impl_->visible_; }
+bool SDLWindow::Exposed() {
+  auto exposed = impl_->exposed_;
+  impl_->exposed_ = false;
+  return exposed;
+}
 struct SDL_Window *SDLWindow::Handle() const { return impl_->window_; }
 
 //
@@ -50,6 +67,10 @@ struct SDLAppImpl {
   const Uint8 *keys_;
   std::vector<char> keyInputBuffer_;
   std::vector<char> tmp_;
+  std::chrono::steady_clock::time_point inputTime_;
+  std::chrono::steady_clock::time_point dequeuedInputTime_;
+  std::vector<AppCommand> commands_;
+  std::vector<AppCommand> tmpCommands_;
   std::unordered_map<Uint32, std::weak_ptr<SDLWindow>> windowMap_;
 
   SDLAppImpl() {
@@ -81,14 +102,24 @@ struct SDLAppImpl {
   std::span<char> DequeueInput() {
     std::swap(tmp_, keyInputBuffer_);
     keyInputBuffer_.clear();
+    dequeuedInputTime_ = inputTime_;
     return {tmp_.data(), tmp_.size()};
   }
 
-  bool NewFrame() {
-    SDL_Delay(20);
+  std::chrono::steady_clock::time_point InputTime() const {
+    return dequeuedInputTime_;
+  }
+
+  std::span<const AppCommand> DequeueCommands() {
+    std::swap(tmpCommands_, commands_);
+    commands_.clear();
+    return {tmpCommands_.data(), tmpCommands_.size()};
+  }
 
+  bool NewFrame() {
     SDL_Event event;
-    while (SDL_PollEvent(&event))
+    while (SDL_PollEvent(&event)) {
+      auto had_input = !keyInputBuffer_.empty();
       switch (event.type) {
 
       case SDL_QUIT:
@@ -99,10 +130,20 @@ struct SDLAppImpl {
         HandleWindowEvent(&event);
         break;
 
+      case SDL_RENDER_TARGETS_RESET:
+        commands_.push_back(AppCommand::RenderTargetsReset);
+        break;
+
       case SDL_KEYDOWN:
         HandleKeyEvent(&event);
         break;
 
+      case SDL_MOUSEBUTTONDOWN:
+        if (event.button.button == SDL_BUTTON_RIGHT) {
+          commands_.push_back(AppCommand::Paste);
+        }
+        break;
+
       case SDL_TEXTINPUT:
         for (auto p = event.edit.text; *p; ++p) {
           keyInputBuffer_.push_back(*p);
@@ -110,24 +151,66 @@ struct SDLAppImpl {
         break;
       }
 
+      if (!had_input && !keyInputBuffer_.empty()) {
+        // the event may have waited in the queue, count that too
+        auto age = std::chrono::milliseconds(SDL_GetTicks() -
+                                             event.common.timestamp);
+        inputTime_ = std::chrono::steady_clock::now() - age;
+      }
+    }
+
     return true;
   }
 
 private:
   void HandleWindowEvent(SDL_Event *event) {
+    auto found = windowMap_.find(event->window.windowID);
+    if (found == windowMap_.end()) {
+      return;
+    }
+    auto window = found->second.lock();
+    if (!window) {
+      windowMap_.erase(found);
+      return;
+    }
+    auto impl = window->impl_;
     switch (event->window.event) {
     case SDL_WINDOWEVENT_SIZE_CHANGED:
-      auto found = windowMap_.find(event->window.windowID);
-      if (found != windowMap_.end()) {
-        auto window = found->second.lock();
-        window->impl_->width_ = event->window.data1;
-        window->impl_->height_ = event->window.data2;
-      }
+      impl->width_ = event->window.data1;
+      impl->height_ = event->window.data2;
+      break;
+
+    case SDL_WINDOWEVENT_HIDDEN:
+    case SDL_WINDOWEVENT_MINIMIZED:
+      impl->visible_ = false;
+      break;
+
+    case SDL_WINDOWEVENT_SHOWN:
+    case SDL_WINDOWEVENT_RESTORED:
+    case SDL_WINDOWEVENT_MAXIMIZED:
+      impl->visible_ = true;
+      impl->exposed_ = true;
+      break;
+
+    case SDL_WINDOWEVENT_EXPOSED:
+      impl->exposed_ = true;
       break;
     }
   }
 
   void HandleKeyEvent(SDL_Event *event) {
+    if (event->key.keysym.sym == SDLK_F12 &&
+        (event->key.keysym.mod & KMOD_CTRL) &&
+        (event->key.keysym.mod & KMOD_SHIFT)) {
+      commands_.push_back(AppCommand::ToggleLatencyOverlay);
+      return;
+    }
+    if (event->key.keysym.sym == SDLK_F11 &&
+        (event->key.keysym.mod & KMOD_CTRL) &&
+        (event->key.keysym.mod & KMOD_SHIFT)) {
+      commands_.push_back(AppCommand::ToggleProfiler);
+      return;
+    }
 
     if (this->keys_[SDL_SCANCODE_LCTRL]) {
       int mod = SDL_toupper(event->key.keysym.sym);
@@ -174,6 +257,10 @@ private:
       break;
 
     case SDLK_INSERT:
+      if (event->key.keysym.mod & KMOD_SHIFT) {
+        commands_.push_back(AppCommand::Paste);
+        return;
+      }
       cmd = "\033[2~";
       break;
 
@@ -258,9 +345,16 @@ std::shared_ptr<SDLWindow> SDLApp::CreateWindow(int width, int height,
   }
 
   auto ptr = std::shared_ptr<SDLWindow>(new SDLWindow(window));
+  impl_->windowMap_[SDL_GetWindowID(window)] = ptr;
   return ptr;
 }
 bool SDLApp::NewFrame() { return impl_->NewFrame(); }
 std::span<char> SDLApp::DequeueInput() { return impl_->DequeueInput(); }
+std::chrono::steady_clock::time_point SDLApp::InputTime() const {
+  return impl_->InputTime();
+}
+std::span<const AppCommand> SDLApp::DequeueCommands() {
+  return impl_->DequeueCommands();
+}
 
 } // namespace termtk
@@ -1,5 +1,6 @@
 #pragma once
 #include "SDL_video.h"
+#include <chrono>
 #include <memory>
 #include <span>
 #include <vector>
@@ -15,9 +16,27 @@ public:
   ~SDLWindow();
   int Width() const;
   int Height() const;
+  // of the display showing the window, 0 if unknown
+  int RefreshRate() const;
+  // false while hidden or minimized, nothing drawn would be seen
+  bool Visible() const;
+  // true once after the window was shown, restored or exposed and its
+  // contents need to be presented again
+  bool Exposed();
   struct SDL_Window *Handle() const;
 };
 
+enum class AppCommand {
+  // right click or Shift+Insert
+  Paste,
+  // Ctrl+Shift+F12
+  ToggleLatencyOverlay,
+  // Ctrl+Shift+F11
+  ToggleProfiler,
+  // the renderer lost the contents of its textures
+  RenderTargetsReset,
+};
+
 class SDLApp {
   class SDLAppImpl *impl_ = nullptr;
 
@@ -28,8 +47,12 @@ public:
   ~SDLApp();
   struct std::shared_ptr<SDLWindow> CreateWindow(int width, int height,
                                                  const char *title);
+  // handles the pending window events without waiting
   bool NewFrame();
   std::span<char> DequeueInput();
+  // when the oldest event of the last DequeueInput batch happened
+  std::chrono::steady_clock::time_point InputTime() const;
+  std::span<const AppCommand> DequeueCommands();
 };
 
 } // namespace termtk
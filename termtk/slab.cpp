@@ -0,0 +1,42 @@
+#include "slab.h"
+
+namespace termtk {
+
+void SlabRef::reset() {
+  if (slab_ && slab_->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+    // may be the last reference to the pool, keep it until we are done
+    auto pool = std::move(slab_->pool);
+    pool->Release(slab_);
+  }
+  slab_ = nullptr;
+}
+
+SlabPool::~SlabPool() {
+  for (auto slab : free_) {
+    delete slab;
+  }
+}
+
+SlabRef SlabPool::Get() {
+  Slab *slab = nullptr;
+  {
+    std::lock_guard<std::mutex> lock(mtx_);
+    if (!free_.empty()) {
+      slab = free_.back();
+      free_.pop_back();
+    }
+  }
+  if (!slab) {
+    slab = new Slab;
+  }
+  slab->size = 0;
+  slab->pool = shared_from_this();
+  return SlabRef(slab);
+}
+
+void SlabPool::Release(Slab *slab) {
+  std::lock_guard<std::mutex> lock(mtx_);
+  free_.push_back(slab);
+}
+
+} // namespace termtk
@@ -0,0 +1,71 @@
+#pragma once
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <stddef.h>
+#include <utility>
+#include <vector>
+
+namespace termtk {
+
+class SlabPool;
+
+// Fixed size buffer the pty reader fills once. The parser, a recorder or
+// a mirror all hold references to the same bytes; the slab goes back to
+// its pool when the last reference is dropped.
+struct Slab {
+  static constexpr size_t Capacity = 16 * 1024;
+
+  std::atomic<int> refs{0};
+  size_t size = 0;
+  // keeps the pool alive while the slab is checked out
+  std::shared_ptr<SlabPool> pool;
+  char data[Capacity];
+};
+
+class SlabRef {
+  Slab *slab_ = nullptr;
+
+public:
+  SlabRef() = default;
+  explicit SlabRef(Slab *slab) : slab_(slab) {
+    if (slab_) {
+      slab_->refs.fetch_add(1, std::memory_order_relaxed);
+    }
+  }
+  SlabRef(const SlabRef &rhs) : SlabRef(rhs.slab_) {}
+  SlabRef(SlabRef &&rhs) noexcept : slab_(std::exchange(rhs.slab_, nullptr)) {}
+  SlabRef &operator=(SlabRef rhs) noexcept {
+    std::swap(slab_, rhs.slab_);
+    return *this;
+  }
+  ~SlabRef() { reset(); }
+
+  void reset();
+
+  const char *data() const { return slab_ ? slab_->data : nullptr; }
+  size_t size() const { return slab_ ? slab_->size : 0; }
+  bool empty() const { return size() == 0; }
+  // for the producer, before handing out copies
+  char *mutable_data() { return slab_->data; }
+  void set_size(size_t size) { slab_->size = size; }
+};
+
+class SlabPool : public std::enable_shared_from_this<SlabPool> {
+  friend class SlabRef;
+  std::mutex mtx_;
+  std::vector<Slab *> free_;
+
+  SlabPool() = default;
+  void Release(Slab *slab);
+
+public:
+  static std::shared_ptr<SlabPool> Create() {
+    return std::shared_ptr<SlabPool>(new SlabPool);
+  }
+  ~SlabPool();
+  // an empty slab, recycled when possible
+  SlabRef Get();
+};
+
+} // namespace termtk
@@ -0,0 +1,156 @@
+#include "trace.h"
+
+#ifdef TERMTK_TRACE
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+
+namespace termtk::trace {
+
+namespace {
+
+struct Event {
+  const char *name;
+  int64_t begin;
+  int64_t end;
+};
+
+// Written by its thread only. The dumper reads head and copies the slots
+// below it; slots the writer may have lapped meanwhile are dropped. The
+// fields are atomic only so that a lapped copy is merely stale, relaxed
+// stores cost the writer nothing extra.
+struct Ring {
+  static constexpr uint64_t Capacity = 1 << 16;
+  struct Slot {
+    std::atomic<const char *> name;
+    std::atomic<int64_t> begin;
+    std::atomic<int64_t> end;
+  } slots[Capacity];
+  std::atomic<uint64_t> head{0};
+  int tid;
+};
+
+struct Registry {
+  std::mutex mutex;
+  // rings outlive their threads, a dump still shows what they did
+  std::vector<Ring *> rings;
+  std::string path;
+  Clock::time_point start = Clock::now();
+};
+
+Registry &registry() {
+  // never destroyed, threads may still record while exit handlers run
+  static auto registry = new Registry;
+  return *registry;
+}
+
+std::atomic<bool> dump_requested{false};
+
+Ring *ThreadRing() {
+  thread_local Ring *ring = nullptr;
+  if (!ring) {
+    auto &r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    ring = new Ring;
+    ring->tid = (int)r.rings.size() + 1;
+    r.rings.push_back(ring);
+  }
+  return ring;
+}
+
+void OnSignal(int) { dump_requested.store(true, std::memory_order_relaxed); }
+
+void DumpAtExit() {
+  auto &r = registry();
+  if (!r.path.empty()) {
+    Dump(r.path.c_str());
+  }
+}
+
+} // namespace
+
+void Record(const char *name, Clock::time_point begin,
+            Clock::time_point end) {
+  auto ring = ThreadRing();
+  auto head = ring->head.load(std::memory_order_relaxed);
+  auto &slot = ring->slots[head % Ring::Capacity];
+  slot.name.store(name, std::memory_order_relaxed);
+  slot.begin.store(begin.time_since_epoch().count(), std::memory_order_relaxed);
+  slot.end.store(end.time_since_epoch().count(), std::memory_order_relaxed);
+  ring->head.store(head + 1, std::memory_order_release);
+}
+
+void Install(const char *path) {
+  auto &r = registry();
+  {
+    std::lock_guard<std::mutex> lock(r.mutex);
+    r.path = path;
+  }
+#ifdef SIGUSR1
+  signal(SIGUSR1, OnSignal);
+#endif
+  static bool once = (atexit(DumpAtExit), true);
+  (void)once;
+}
+
+void Poll() {
+  if (dump_requested.exchange(false, std::memory_order_relaxed)) {
+    DumpAtExit();
+  }
+}
+
+bool Dump(const char *path) {
+  auto &r = registry();
+  std::lock_guard<std::mutex> lock(r.mutex);
+  auto f = fopen(path, "w");
+  if (!f) {
+    return false;
+  }
+  auto start = r.start.time_since_epoch().count();
+  auto us = [&](int64_t t) {
+    return std::chrono::duration<double, std::micro>(
+               Clock::duration(t - start))
+        .count();
+  };
+  fputs("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[", f);
+  bool first = true;
+  std::vector<Event> events;
+  for (auto ring : r.rings) {
+    auto head = ring->head.load(std::memory_order_acquire);
+    auto tail = head > Ring::Capacity ? head - Ring::Capacity : 0;
+    events.clear();
+    for (auto i = tail; i < head; ++i) {
+      auto &slot = ring->slots[i % Ring::Capacity];
+      events.push_back({slot.name.load(std::memory_order_relaxed),
+                        slot.begin.load(std::memory_order_relaxed),
+                        slot.end.load(std::memory_order_relaxed)});
+    }
+    // the writer kept going while we copied, drop what it overwrote. The
+    // slot of event lapped may be half written already, it shares its
+    // slot with event lapped - Capacity
+    auto lapped = ring->head.load(std::memory_order_acquire);
+    auto valid =
+        lapped + 1 > Ring::Capacity ? lapped + 1 - Ring::Capacity : 0;
+    auto skip = valid > tail ? std::min(valid - tail, (uint64_t)events.size())
+                             : 0;
+    for (auto i = skip; i < events.size(); ++i) {
+      auto &event = events[i];
+      fprintf(f,
+              "%s\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,"
+              "\"ts\":%.3f,\"dur\":%.3f}",
+              first ? "" : ",", event.name, ring->tid, us(event.begin),
+              us(event.end) - us(event.begin));
+      first = false;
+    }
+  }
+  fputs("\n]}\n", f);
+  return fclose(f) == 0;
+}
+
+} // namespace termtk::trace
+#endif
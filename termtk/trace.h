@@ -0,0 +1,50 @@
+#pragma once
+
+// Scoped trace markers for a timeline of the hot paths, viewable in
+// chrome://tracing or ui.perfetto.dev. Every thread records into its own
+// ring buffer without locking; the newest events of all threads are
+// dumped as Chrome trace JSON on SIGUSR1 (picked up by TRACE_POLL) and at
+// exit. Without TERMTK_TRACE defined the macros expand to nothing.
+//
+//   TRACE_SCOPE("Terminal::input_write");
+
+#ifdef TERMTK_TRACE
+#include <chrono>
+
+namespace termtk::trace {
+
+using Clock = std::chrono::steady_clock;
+
+// name must be a string literal, only the pointer is kept
+void Record(const char *name, Clock::time_point begin,
+            Clock::time_point end);
+// dump to path on SIGUSR1 and at exit
+void Install(const char *path);
+// dumps if SIGUSR1 arrived since the last call
+void Poll();
+bool Dump(const char *path);
+
+class Scope {
+  const char *name_;
+  Clock::time_point begin_;
+
+public:
+  explicit Scope(const char *name) : name_(name), begin_(Clock::now()) {}
+  Scope(const Scope &) = delete;
+  Scope &operator=(const Scope &) = delete;
+  ~Scope() { Record(name_, begin_, Clock::now()); }
+};
+
+} // namespace termtk::trace
+
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+#define TRACE_SCOPE(name)                                                      \
+  ::termtk::trace::Scope TRACE_CONCAT(trace_scope_, __LINE__)(name)
+#define TRACE_INSTALL(path) ::termtk::trace::Install(path)
+#define TRACE_POLL() ::termtk::trace::Poll()
+#else
+#define TRACE_SCOPE(name) ((void)0)
+#define TRACE_INSTALL(path) ((void)0)
+#define TRACE_POLL() ((void)0)
+#endif
@@ -1,10 +1,26 @@
 #include "vterm_object.h"
 #include "vterm.h"
-#include <iostream>
+#include <algorithm>
 #include <string.h>
+#include <trace.h>
 
 namespace termtk {
 
+void DamageList::Resize(int rows, int cols) {
+  rows_ = rows;
+  cols_ = cols;
+  list_.clear();
+  list_.reserve((size_t)rows * cols);
+  marked_.assign((size_t)rows * cols, 0);
+}
+
+void DamageList::clear() {
+  for (auto &pos : list_) {
+    marked_[pos.row * cols_ + pos.col] = 0;
+  }
+  list_.clear();
+}
+
 int Terminal::damage(VTermRect rect, void *user) {
   return ((Terminal *)user)
       ->damage(rect.start_row, rect.start_col, rect.end_row, rect.end_col);
@@ -26,7 +42,6 @@ int Terminal::settermprop(VTermProp prop, VTermValue *val, void *user) {
 int Terminal::bell(void *user) { return ((Terminal *)user)->bell(); }
 
 int Terminal::resize(int rows, int cols, void *user) {
-  std::cout << "resize: " << rows << ", " << cols << std::endl;
   return ((Terminal *)user)->resize(rows, cols);
 }
 
@@ -41,11 +56,15 @@ int Terminal::sb_popline(int cols, VTermScreenCell *cells, void *user) {
 Terminal::Terminal(int _rows, int _cols, int font_width, int font_height,
                    VTermOutputCallback out, void *user) {
   vterm_ = vterm_new(_rows, _cols);
+  damaged_.Resize(_rows, _cols);
+  tmp_.Resize(_rows, _cols);
   vterm_set_utf8(vterm_, 1);
   vterm_output_set_callback(vterm_, out, user);
 
   screen_ = vterm_obtain_screen(vterm_);
   vterm_screen_set_callbacks(screen_, &screen_callbacks, this);
+  // keep the primary screen intact while full screen apps run
+  vterm_screen_enable_altscreen(screen_, 1);
   vterm_screen_reset(screen_, 1);
 }
 
@@ -59,26 +78,22 @@ void Terminal::keyboard_key(VTermKey key, VTermModifier mod) {
   vterm_keyboard_key(vterm_, key, mod);
 }
 
+void Terminal::paste_start() { vterm_keyboard_start_paste(vterm_); }
+
+void Terminal::paste_end() { vterm_keyboard_end_paste(vterm_); }
+
 void Terminal::input_write(const char *bytes, size_t len) {
+  TRACE_SCOPE("Terminal::input_write");
   vterm_input_write(vterm_, bytes, len);
 }
 
-const PosSet &Terminal::new_frame(bool *ringing) {
+const DamageList &Terminal::new_frame(bool *ringing) {
+  TRACE_SCOPE("Terminal::new_frame");
   *ringing = ringing_;
   ringing_ = false;
 
-#if 1
+  // hand out this frame's list, the other one collects the next frame
   std::swap(damaged_, tmp_);
-#else
-  tmp_.clear();
-  int rows, cols;
-  vterm_get_size(vterm_, &rows, &cols);
-  for (int row = 0; row < rows; ++row) {
-    for (int col = 0; col < cols; ++col) {
-      tmp_.insert({.row = row, .col = col});
-    }
-  }
-#endif
   damaged_.clear();
   return tmp_;
 }
@@ -104,14 +119,42 @@ VTermScreenCell *Terminal::get_cursor(VTermPos *pos) const {
   return &cell_;
 }
 
+uint64_t Terminal::row_hash(int row, int cols) const {
+  uint64_t hash = 0xcbf29ce484222325ull;
+  auto mix = [&hash](uint64_t value) {
+    hash = (hash ^ value) * 0x9e3779b97f4a7c15ull;
+    hash ^= hash >> 32;
+  };
+  mix(cols);
+
+  // zeroed once so the padding bits of attrs stay deterministic
+  VTermScreenCell cell = {};
+  for (int col = 0; col < cols; ++col) {
+    vterm_screen_get_cell(screen_, {.row = row, .col = col}, &cell);
+    uint32_t attrs = 0;
+    memcpy(&attrs, &cell.attrs, std::min(sizeof(attrs), sizeof(cell.attrs)));
+    uint32_t fg;
+    uint32_t bg;
+    static_assert(sizeof(fg) == sizeof(cell.fg));
+    memcpy(&fg, &cell.fg, sizeof(fg));
+    memcpy(&bg, &cell.bg, sizeof(bg));
+    mix((uint64_t)cell.chars[0] << 32 | attrs);
+    mix((uint64_t)fg << 32 | bg);
+    for (int i = 1; i < VTERM_MAX_CHARS_PER_CELL && cell.chars[i]; ++i) {
+      mix(cell.chars[i]);
+    }
+  }
+  return hash;
+}
+
 void Terminal::set_rows_cols(int rows, int cols) {
+  // vterm damages the new grid from within vterm_set_size
+  damaged_.Resize(rows, cols);
+  tmp_.Resize(rows, cols);
   vterm_set_size(vterm_, rows, cols);
 }
 
 int Terminal::damage(int start_row, int start_col, int end_row, int end_col) {
-  // std::cout << "damage: (" << start_row << ", " << start_col << ")-(" <<
-  // end_row
-  //           << "," << end_col << ")" << std::endl;
   for (int row = start_row; row < end_row; row++) {
     for (int col = start_col; col < end_col; col++) {
       damaged_.insert(VTermPos{
@@ -124,7 +167,7 @@ int Terminal::damage(int start_row, int start_col, int end_row, int end_col) {
 }
 
 int Terminal::moverect(VTermRect dest, VTermRect src) {
-  std::cout << "moverect" << std::endl;
+  // not handled, vterm damages dest instead
   return 0;
 }
 
@@ -133,69 +176,35 @@ int Terminal::movecursor(VTermPos pos, VTermPos oldpos, int visible) {
   return 0;
 }
 
+// Runs from within input_write, possibly many times per frame; nothing here
+// may log or allocate.
 int Terminal::settermprop(VTermProp prop, VTermValue *val) {
   switch (prop) {
-  case VTERM_PROP_CURSORVISIBLE:
-    // bool
-    std::cout << "VTERM_PROP_CURSORVISIBLE: " << val->boolean << std::endl;
-    break;
-  case VTERM_PROP_CURSORBLINK:
-    // bool
-    std::cout << "VTERM_PROP_CURSORBLINK: " << val->boolean << std::endl;
-    break;
   case VTERM_PROP_ALTSCREEN:
     // bool
-    std::cout << "VTERM_PROP_ALTSCREEN: " << val->boolean << std::endl;
-    break;
-  case VTERM_PROP_TITLE:
-    // string
-    std::cout << "VTERM_PROP_TITLE: "
-              << std::string_view(val->string.str, val->string.len)
-              << std::endl;
-    break;
-  case VTERM_PROP_ICONNAME:
-    // string
-    std::cout << "VTERM_PROP_ICONNAME: "
-              << std::string_view(val->string.str, val->string.len)
-              << std::endl;
-    break;
-  case VTERM_PROP_REVERSE:
-    // bool
-    std::cout << "VTERM_PROP_REVERSE: " << val->boolean << std::endl;
-    break;
-  case VTERM_PROP_CURSORSHAPE:
-    // number
-    std::cout << "VTERM_PROP_CURSORSHAPE: " << val->number << std::endl;
-    break;
-  case VTERM_PROP_MOUSE:
-    // number
-    std::cout << "VTERM_PROP_MOUSE: " << val->number << std::endl;
+    altscreen_ = val->boolean;
     break;
   default:
-    std::cout << "unknown prop: " << prop << std::endl;
+    // cursor visibility, blink and shape, title, icon name, reverse video
+    // and mouse mode are not used yet
+    break;
   }
-  return 0;
+  // accepted, otherwise vterm does not track the new state
+  return 1;
 }
 
 int Terminal::bell() {
-  std::cout << "bell" << std::endl;
   ringing_ = true;
   return 0;
 }
 
-int Terminal::resize(int rows, int cols) {
-  std::cout << "resize" << std::endl;
-  return 0;
-}
+int Terminal::resize(int rows, int cols) { return 0; }
 
 int Terminal::sb_pushline(int cols, const VTermScreenCell *cells) {
-  std::cout << "sb_pushline" << std::endl;
+  // no scrollback yet
   return 0;
 }
 
-int Terminal::sb_popline(int cols, VTermScreenCell *cells) {
-  std::cout << "sb_popline" << std::endl;
-  return 0;
-}
+int Terminal::sb_popline(int cols, VTermScreenCell *cells) { return 0; }
 
 } // namespace termtk
\ No newline at end of file
@@ -1,34 +1,51 @@
 #pragma once
-#include <functional>
+#include <cstdint>
 #include <memory>
 #include <stdexcept>
-#include <unordered_set>
+#include <vector>
 #include <vterm.h>
 
-template <> struct ::std::hash<VTermPos> {
-  std::size_t operator()(const VTermPos &p) const noexcept {
-    return p.row << 16 | p.col;
-  }
-};
-
 namespace termtk {
-struct PosEqual {
-  constexpr bool operator()(VTermPos lhs, VTermPos rhs) const {
-    return lhs.row == rhs.row && lhs.col == rhs.col;
+
+// The cells damaged since the last frame, each listed once in the order
+// they were damaged. Storage is sized for the whole grid up front, so
+// inserting and clearing never allocate; only Resize does.
+class DamageList {
+  std::vector<VTermPos> list_;
+  // one byte per cell, set while the cell is listed
+  std::vector<uint8_t> marked_;
+  int rows_ = 0;
+  int cols_ = 0;
+
+public:
+  void Resize(int rows, int cols);
+  void insert(VTermPos pos) {
+    if (pos.row < 0 || pos.row >= rows_ || pos.col < 0 || pos.col >= cols_) {
+      return;
+    }
+    auto &marked = marked_[pos.row * cols_ + pos.col];
+    if (!marked) {
+      marked = 1;
+      list_.push_back(pos);
+    }
   }
+  void clear();
+  size_t size() const { return list_.size(); }
+  bool empty() const { return list_.empty(); }
+  auto begin() const { return list_.begin(); }
+  auto end() const { return list_.end(); }
 };
 
-using PosSet = std::unordered_set<::VTermPos, std::hash<::VTermPos>, PosEqual>;
-
 class Terminal {
   VTerm *vterm_;
   VTermScreen *screen_;
   VTermPos cursor_pos_;
   mutable VTermScreenCell cell_;
   bool ringing_ = false;
+  bool altscreen_ = false;
 
-  PosSet damaged_;
-  PosSet tmp_;
+  DamageList damaged_;
+  DamageList tmp_;
 
 public:
   Terminal(int _rows, int _cols, int font_width, int font_height,
@@ -37,9 +54,15 @@ public:
   void input_write(const char *bytes, size_t len);
   void keyboard_unichar(char c, VTermModifier mod);
   void keyboard_key(VTermKey key, VTermModifier mod);
-  const PosSet &new_frame(bool *ringing);
+  // emit the bracketed paste markers if the child enabled mode 2004
+  void paste_start();
+  void paste_end();
+  const DamageList &new_frame(bool *ringing);
+  bool altscreen() const { return altscreen_; }
   VTermScreenCell *get_cell(VTermPos pos) const;
   VTermScreenCell *get_cursor(VTermPos *pos) const;
+  // cheap hash of everything that affects how the row looks
+  uint64_t row_hash(int row, int cols) const;
   void set_rows_cols(int rows, int cols);
 
 private:
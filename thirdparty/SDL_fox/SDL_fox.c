@@ -15,10 +15,17 @@
 #include "SDL_fox.h"
 #include <ft2build.h>
 #include FT_FREETYPE_H
+#include FT_OUTLINE_H
 #ifdef FOX_USE_FONTCONFIG
 #include <fontconfig.h>
 #endif
 
+/* Glyph bitmaps are packed into the atlas with the skyline packer from
+ * stb (shared with libfond, see thirdparty/libfond/src). */
+#define STB_RECT_PACK_IMPLEMENTATION
+#define STBRP_STATIC
+#include "stb_rect_pack.h"
+
 /******************************************************************************
  * SDL_fox library state and initialization
  *****************************************************************************/
@@ -110,14 +117,50 @@ static Uint32 FOX_Utf8Decode(const Uint8* sequence, const Uint8** endptr) {
  * Font definition and open/close
  *****************************************************************************/
 
+/* Load state of a glyph slot in the atlas */
+enum FOX_GlyphState {
+	FOX_GLYPH_UNLOADED,
+	FOX_GLYPH_LOADED,
+	FOX_GLYPH_UNAVAILABLE	/* could not be rasterized or packed */
+};
+
+/* Codepoint resolution cache entry. `font` is the font of the fallback
+ * chain that provides the codepoint, or NULL if none of them does. */
+typedef struct {
+	Uint32 ch;
+	FOX_Font *font;
+	FT_UInt index;
+} FOX_CacheEntry;
+
+#define FOX_CACHE_EMPTY 0xffffffff
+
+/* every combination of FOX_STYLE_BOLD and FOX_STYLE_ITALIC */
+#define FOX_STYLE_COUNT 4
+
 struct FOX_Font {
 	SDL_Renderer *renderer;
 	SDL_Texture *atlas;
-	FOX_GlyphMetrics *metrics;
+	/* per style, indexed by glyph index; styles other than
+	 * FOX_STYLE_NORMAL are allocated on first use */
+	FOX_GlyphMetrics *metrics[FOX_STYLE_COUNT];
+	Uint8 *state[FOX_STYLE_COUNT];	/* enum FOX_GlyphState */
+	int style;	/* style used by the render functions */
 	FT_Face face;	/* freetype font face */
-	int length;		/* side length of the atlas texture (sqrt(width^2)) */
+	int atlas_width;	/* dimensions of the packed atlas texture */
+	int atlas_height;
+	stbrp_context pack;	/* packer state, kept to add glyphs lazily */
+	stbrp_node *nodes;
+	Uint32 *scratch;	/* upload buffer for lazily rasterized glyphs */
+	int scratch_size;
+	FOX_Font **fallbacks;
+	int num_fallbacks;
+	FOX_CacheEntry *cache;
+	int cache_capacity;	/* power of two */
+	int cache_count;
 	FOX_FontMetrics size;
 	SDL_bool use_kerning;
+	Uint32 glyph_hits;	/* lookups served from the atlas */
+	Uint32 glyph_misses;	/* lookups that had to rasterize or failed */
 };
 
 #ifdef FOX_USE_FONTCONFIG
@@ -139,7 +182,8 @@ FOX_Font* FOX_OpenFontFc(SDL_Renderer *renderer, const unsigned char *fontstr) {
 	FcPatternGetString(match, FC_FILE, 0, &path);
 	FcPatternGetInteger(match, FC_SIZE, 0, &size);
 
-	FOX_Font *font = FOX_OpenFont(renderer, (const char*)path, size);
+	FOX_Font *font = FOX_OpenFontEx(renderer, (const char*)path, size,
+															FOX_FONT_DEFAULT);
 	FcPatternDestroy(match);
 	FcPatternDestroy(pattern);
 	return font;
@@ -147,8 +191,18 @@ FOX_Font* FOX_OpenFontFc(SDL_Renderer *renderer, const unsigned char *fontstr) {
 #endif /* FOX_USE_FONTCONFIG */
 
 static SDL_Surface* FOX_RenderFontToSurface(FOX_Font *font);
+static SDL_bool FOX_CreateAtlas(FOX_Font *font, SDL_Surface *surface);
+static void FOX_InitPacker(FOX_Font *font, int width, int height);
+static int FOX_MaxTextureSize(SDL_Renderer *renderer);
+static int FOX_NextPowerOfTwo(int n);
 
 FOX_Font* FOX_OpenFont(SDL_Renderer *renderer, const char *path, int size) {
+	return FOX_OpenFontEx(renderer, path, size, FOX_FONT_DEFAULT);
+}
+
+FOX_Font* FOX_OpenFontEx(SDL_Renderer *renderer, const char *path, int size,
+															Uint32 flags
+) {
 	FOX_Font *font = SDL_calloc(1, sizeof(*font));
 	font->renderer = renderer;
 
@@ -162,28 +216,48 @@ FOX_Font* FOX_OpenFont(SDL_Renderer *renderer, const char *path, int size) {
 		goto abort1;
 	}
 
-	/* Calculate atlas surface dimensions */
-	int length = (int)SDL_ceil(SDL_sqrt(font->face->num_glyphs));
-
 	/* Set font parameters */
-	font->length = length;
 	font->size.ptsize = size;
 	font->size.height = font->face->size->metrics.height >> 6;
 	font->use_kerning = FT_HAS_KERNING(font->face);
 
-	/* Render characters to surface */
-	SDL_Surface *surface = FOX_RenderFontToSurface(font);
-	if(!surface) goto abort1;
-	
-	/* Convert SDL surface into SDL texture and enable alpha blending */
-	font->atlas = SDL_CreateTextureFromSurface(font->renderer, surface);
-	SDL_SetTextureBlendMode(font->atlas, SDL_BLENDMODE_BLEND);
+	font->state[FOX_STYLE_NORMAL] = SDL_calloc(font->face->num_glyphs, 1);
+	if(!font->state[FOX_STYLE_NORMAL]) goto abort1;
+
+	SDL_Surface *surface = NULL;
+	if(flags & FOX_FONT_LAZY) {
+		/* Nothing is rasterized up front, so the font metrics come from
+		 * the face. The atlas is sized to hold a few thousand cells. */
+		font->metrics[FOX_STYLE_NORMAL] = SDL_calloc(
+				font->face->num_glyphs, sizeof(FOX_GlyphMetrics));
+		if(!font->metrics[FOX_STYLE_NORMAL]) goto abort1;
+		font->size.max_advance = font->face->size->metrics.max_advance >> 6;
+		font->size.max_width = font->size.max_advance;
+		font->size.max_height = font->size.height;
+
+		int length = FOX_NextPowerOfTwo(size * 64);
+		length = SDL_min(length, FOX_MaxTextureSize(renderer));
+		font->atlas_width = font->atlas_height = length;
+		FOX_InitPacker(font, length, length);
+	} else {
+		/* Render characters to surface */
+		surface = FOX_RenderFontToSurface(font);
+		if(!surface) goto abort1;
+	}
+	if(!font->nodes) goto abort2;
+
+	if(!FOX_CreateAtlas(font, surface)) goto abort2;
 	SDL_FreeSurface(surface);
 
 	return font;
 
 	/* Premature error handling */
+	abort2:
+		SDL_FreeSurface(surface);
 	abort1:
+		SDL_free(font->nodes);
+		SDL_free(font->metrics[FOX_STYLE_NORMAL]);
+		SDL_free(font->state[FOX_STYLE_NORMAL]);
 		FT_Done_Face(font->face);
 	abort0:
 		SDL_free(font);
@@ -193,81 +267,517 @@ FOX_Font* FOX_OpenFont(SDL_Renderer *renderer, const char *path, int size) {
 void FOX_CloseFont(FOX_Font *font) {
 	SDL_DestroyTexture(font->atlas);
 	FT_Done_Face(font->face);
-	SDL_free(font->metrics);
+	for(int style = 0; style < FOX_STYLE_COUNT; style++) {
+		SDL_free(font->metrics[style]);
+		SDL_free(font->state[style]);
+	}
+	SDL_free(font->nodes);
+	SDL_free(font->scratch);
+	SDL_free(font->fallbacks);
+	SDL_free(font->cache);
 	SDL_free(font);
 }
 
 /*****************************************************************************/
 
-static void FOX_SetMetrics(FOX_Font *font, Uint32 index, int xpos, int ypos) {
-	font->metrics[index].rect.x = xpos * font->size.ptsize;
-	font->metrics[index].rect.y = ypos * font->size.ptsize;
-	font->metrics[index].rect.w = font->face->glyph->metrics.width >> 6;
-	font->metrics[index].rect.h = font->face->glyph->metrics.height >> 6;
-	font->metrics[index].bearing.x = font->face->glyph->metrics.horiBearingX >> 6;
-	font->metrics[index].bearing.y = font->face->glyph->metrics.horiBearingY >> 6;
-	font->metrics[index].advance = font->face->glyph->metrics.horiAdvance >> 6;
-	if(font->size.max_width < font->metrics[index].rect.w) {
-		font->size.max_width = font->metrics[index].rect.w;
+static void FOX_SetMetrics(FOX_Font *font, int style, Uint32 index,
+														int x, int y
+) {
+	FT_GlyphSlot slot = font->face->glyph;
+	FOX_GlyphMetrics *metrics = &font->metrics[style][index];
+	metrics->rect.x = x;
+	metrics->rect.y = y;
+	metrics->rect.w = slot->bitmap.width;
+	metrics->rect.h = slot->bitmap.rows;
+	metrics->bearing.x = slot->bitmap_left;
+	metrics->bearing.y = slot->bitmap_top;
+	metrics->advance = slot->metrics.horiAdvance >> 6;
+}
+
+static void FOX_UpdateFontMetrics(FOX_Font *font, Uint32 index) {
+	const FOX_GlyphMetrics *metrics = &font->metrics[FOX_STYLE_NORMAL][index];
+	if(font->size.max_width < metrics->rect.w) {
+		font->size.max_width = metrics->rect.w;
 	}
-	if(font->size.max_height < font->metrics[index].rect.h) {
-		font->size.max_height = font->metrics[index].rect.h;
+	if(font->size.max_height < metrics->rect.h) {
+		font->size.max_height = metrics->rect.h;
 	}
-	if(font->size.max_advance < font->metrics[index].advance) {
-		font->size.max_advance = font->metrics[index].advance;
+	if(font->size.max_advance < metrics->advance) {
+		font->size.max_advance = metrics->advance;
 	}
 }
 
-SDL_Surface* FOX_RenderFontToSurface(FOX_Font *font) {
-	/* Allocate SDL surface */
-	int width = font->length * font->size.ptsize;
-	SDL_Surface *surface = SDL_CreateRGBSurfaceWithFormat(0, width, width,
-												32, SDL_PIXELFORMAT_RGBA32);
-	if(!surface) return NULL;
+/* A rasterized glyph waiting to be placed into the atlas. The coverage
+ * bytes live in a shared staging buffer at `offset`. */
+typedef struct {
+	FT_UInt index;
+	size_t offset;
+	int width;
+	int rows;
+} FOX_PendingGlyph;
+
+static int FOX_MaxTextureSize(SDL_Renderer *renderer) {
+	SDL_RendererInfo info;
+	int size = 0;
+	if(renderer && SDL_GetRendererInfo(renderer, &info) == 0) {
+		size = SDL_min(info.max_texture_width, info.max_texture_height);
+	}
+	/* 0 means the backend does not report a limit */
+	return size > 0 ? size : 8192;
+}
 
-	/* Allocate glyph metrics array */
-	font->metrics = SDL_malloc(sizeof(*font->metrics) * font->face->num_glyphs);
-	if(!font->metrics) {
-		SDL_FreeSurface(surface);
-		return NULL;
+static int FOX_NextPowerOfTwo(int n) {
+	int p = 1;
+	while(p < n) p <<= 1;
+	return p;
+}
+
+/* (Re)initializes the persistent packer over the whole atlas. The context
+ * keeps pointers into itself, so it must live inside the font. */
+static void FOX_InitPacker(FOX_Font *font, int width, int height) {
+	SDL_free(font->nodes);
+	font->nodes = SDL_malloc(sizeof(*font->nodes) * width);
+	if(font->nodes) {
+		stbrp_init_target(&font->pack, width, height, font->nodes, width);
 	}
+}
 
-	FT_UInt index;
-	int xpos = 0;
-	int ypos = 0;
+/* Packs the glyph rects as tightly as possible. Starts from the smallest
+ * power of two square that can hold the summed glyph area and grows the
+ * shorter side until everything fits or the renderer limit is hit. The
+ * packer of the successful attempt is kept for lazily added glyphs. */
+static SDL_bool FOX_PackGlyphs(FOX_Font *font, stbrp_rect *rects, int count,
+												long area
+) {
+	int max_size = FOX_MaxTextureSize(font->renderer);
+	int width = FOX_NextPowerOfTwo((int)SDL_ceil(SDL_sqrt((double)area)));
+	int height = width;
+	if(width < 1) width = height = 1;
+
+	while(width <= max_size && height <= max_size) {
+		FOX_InitPacker(font, width, height);
+		if(!font->nodes) return SDL_FALSE;
+		stbrp_pack_rects(&font->pack, rects, count);
+
+		SDL_bool packed = SDL_TRUE;
+		for(int i = 0; i < count; i++) {
+			if(!rects[i].was_packed) {
+				packed = SDL_FALSE;
+				break;
+			}
+		}
+		if(packed) {
+			font->atlas_width = width;
+			font->atlas_height = height;
+			return SDL_TRUE;
+		}
+
+		if(height < width) height <<= 1;
+		else width <<= 1;
+	}
+
+	SDL_free(font->nodes);
+	font->nodes = NULL;
+	SDL_SetError("SDL_fox: glyphs do not fit into a %dx%d texture",
+											max_size, max_size);
+	return SDL_FALSE;
+}
+
+/* Creates the atlas texture, filled from `surface` if one is given. The
+ * texture is always RGBA32 so that glyphs can be uploaded into it later
+ * without knowing the renderer's native format. */
+static SDL_bool FOX_CreateAtlas(FOX_Font *font, SDL_Surface *surface) {
+	font->atlas = SDL_CreateTexture(font->renderer, SDL_PIXELFORMAT_RGBA32,
+		SDL_TEXTUREACCESS_STATIC, font->atlas_width, font->atlas_height);
+	if(!font->atlas) return SDL_FALSE;
+
+	if(surface) {
+		SDL_UpdateTexture(font->atlas, NULL, surface->pixels, surface->pitch);
+	}
+	SDL_SetTextureBlendMode(font->atlas, SDL_BLENDMODE_BLEND);
+	return SDL_TRUE;
+}
 
+SDL_Surface* FOX_RenderFontToSurface(FOX_Font *font) {
+	SDL_Surface *surface = NULL;
+	FOX_PendingGlyph *glyphs = NULL;
+	stbrp_rect *rects = NULL;
+	Uint8 *staging = NULL;
+	size_t staging_size = 0;
+	size_t staging_capacity = 0;
+	long area = 0;
+	int count = 0;
+
+	/* Allocate glyph metrics array */
+	FOX_GlyphMetrics *all_metrics = SDL_calloc(font->face->num_glyphs,
+											sizeof(FOX_GlyphMetrics));
+	Uint8 *state = font->state[FOX_STYLE_NORMAL];
+	font->metrics[FOX_STYLE_NORMAL] = all_metrics;
+	glyphs = SDL_malloc(sizeof(*glyphs) * font->face->num_glyphs);
+	if(!all_metrics || !glyphs) goto cleanup;
+
+	/* Pass 1: rasterize every mapped glyph once into the staging buffer so
+	 * that the packer knows the real bitmap sizes. */
+	FT_UInt index;
 	for(FT_ULong charcode = FT_Get_First_Char(font->face, &index);
 		index != 0;
 		charcode = FT_Get_Next_Char(font->face, charcode, &index)
 	) {
-		if(xpos < (font->length - 1)) {
-			xpos++;
-		} else {
-			xpos = 0;
-			ypos++;
-		}
+		/* several codepoints may share one glyph */
+		if(state[index] != FOX_GLYPH_UNLOADED) continue;
+		state[index] = FOX_GLYPH_UNAVAILABLE;
 
-		FT_Load_Char(font->face, charcode, FT_LOAD_RENDER);
-		FT_Bitmap *bitmap = &font->face->glyph->bitmap;
+		FT_Load_Glyph(font->face, index, FT_LOAD_RENDER);
+		FT_GlyphSlot slot = font->face->glyph;
+		FT_Bitmap *bitmap = &slot->bitmap;
 		if(bitmap->pixel_mode != ft_pixel_mode_grays) {
 			break;
 		}
 
-		FOX_SetMetrics(font, index, xpos, ypos);
+		size_t bytes = (size_t)bitmap->width * bitmap->rows;
+		if(staging_size + bytes > staging_capacity) {
+			size_t capacity = staging_capacity ? staging_capacity : 4096;
+			while(capacity < staging_size + bytes) capacity *= 2;
+			Uint8 *grown = SDL_realloc(staging, capacity);
+			if(!grown) goto cleanup;
+			staging = grown;
+			staging_capacity = capacity;
+		}
+		for(unsigned int y = 0; y < bitmap->rows; y++) {
+			SDL_memcpy(staging + staging_size + y * bitmap->width,
+					bitmap->buffer + y * bitmap->pitch, bitmap->width);
+		}
+
+		FOX_PendingGlyph *glyph = &glyphs[count++];
+		glyph->index = index;
+		glyph->offset = staging_size;
+		glyph->width = bitmap->width;
+		glyph->rows = bitmap->rows;
+		staging_size += bytes;
+
+		/* record metrics now, the atlas position is patched after packing */
+		FOX_SetMetrics(font, FOX_STYLE_NORMAL, index, 0, 0);
+		FOX_UpdateFontMetrics(font, index);
+
+		/* one pixel of padding keeps bilinear filtering from bleeding */
+		area += (long)(glyph->width + 1) * (glyph->rows + 1);
+	}
 
-		int xreal = xpos * font->size.ptsize;
-		int yreal = ypos * font->size.ptsize;
-		for(int y = 0; y < bitmap->rows; y++) {
-			for(int x = 0; x < bitmap->width; x++) {
-				int index = (yreal + y) * surface->w + xreal + x;
-				Uint32 *pixel = &((Uint32*)surface->pixels)[index];
-				Uint8 alpha = bitmap->buffer[y * bitmap->pitch + x];
-				*pixel = SDL_MapRGBA(surface->format, 255, 255, 255, alpha);
+	/* Pass 2: pack the actual bitmap rects */
+	rects = SDL_malloc(sizeof(*rects) * SDL_max(count, 1));
+	if(!rects) goto cleanup;
+	for(int i = 0; i < count; i++) {
+		rects[i].id = i;
+		rects[i].w = glyphs[i].width ? glyphs[i].width + 1 : 0;
+		rects[i].h = glyphs[i].rows ? glyphs[i].rows + 1 : 0;
+	}
+	if(!FOX_PackGlyphs(font, rects, count, area)) goto cleanup;
+
+	/* Allocate SDL surface */
+	surface = SDL_CreateRGBSurfaceWithFormat(0, font->atlas_width,
+						font->atlas_height, 32, SDL_PIXELFORMAT_RGBA32);
+	if(!surface) goto cleanup;
+
+	/* Pass 3: copy the coverage into the packed positions */
+	for(int i = 0; i < count; i++) {
+		FOX_PendingGlyph *glyph = &glyphs[rects[i].id];
+		FOX_GlyphMetrics *metrics = &all_metrics[glyph->index];
+		metrics->rect.x = rects[i].x;
+		metrics->rect.y = rects[i].y;
+		state[glyph->index] = FOX_GLYPH_LOADED;
+
+		const Uint8 *src = staging + glyph->offset;
+		for(int y = 0; y < glyph->rows; y++) {
+			Uint32 *row = (Uint32*)((Uint8*)surface->pixels +
+									(rects[i].y + y) * surface->pitch);
+			for(int x = 0; x < glyph->width; x++) {
+				Uint8 alpha = src[y * glyph->width + x];
+				row[rects[i].x + x] = SDL_MapRGBA(surface->format,
+												255, 255, 255, alpha);
 			}
 		}
 	}
 
-	return surface;
+	cleanup:
+		SDL_free(rects);
+		SDL_free(staging);
+		SDL_free(glyphs);
+		return surface;
+}
+
+/*****************************************************************************/
+
+static void FOX_ClearCache(FOX_Font *font) {
+	for(int i = 0; i < font->cache_capacity; i++) {
+		font->cache[i].ch = FOX_CACHE_EMPTY;
+	}
+	font->cache_count = 0;
+}
+
+/* Doubles the atlas height, keeping the glyphs already placed. Only the
+ * height grows, so the skyline of the packer stays valid as it is. */
+static SDL_bool FOX_GrowAtlas(FOX_Font *font) {
+	int height = font->atlas_height * 2;
+	if(height > FOX_MaxTextureSize(font->renderer)) return SDL_FALSE;
+	if(!SDL_RenderTargetSupported(font->renderer)) return SDL_FALSE;
+
+	SDL_Texture *atlas = SDL_CreateTexture(font->renderer,
+		SDL_PIXELFORMAT_RGBA32, SDL_TEXTUREACCESS_TARGET,
+		font->atlas_width, height);
+	if(!atlas) return SDL_FALSE;
+
+	/* copy the old atlas over on the GPU, restoring the renderer state */
+	SDL_Color color;
+	SDL_Texture *target = SDL_GetRenderTarget(font->renderer);
+	SDL_GetRenderDrawColor(font->renderer, &color.r, &color.g,
+												&color.b, &color.a);
+	SDL_SetRenderTarget(font->renderer, atlas);
+	SDL_SetRenderDrawColor(font->renderer, 0, 0, 0, 0);
+	SDL_RenderClear(font->renderer);
+	SDL_Rect area = {0, 0, font->atlas_width, font->atlas_height};
+	SDL_SetTextureBlendMode(font->atlas, SDL_BLENDMODE_NONE);
+	SDL_SetTextureColorMod(font->atlas, 255, 255, 255);
+	SDL_RenderCopy(font->renderer, font->atlas, NULL, &area);
+	SDL_SetRenderTarget(font->renderer, target);
+	SDL_SetRenderDrawColor(font->renderer, color.r, color.g,
+												color.b, color.a);
+
+	SDL_DestroyTexture(font->atlas);
+	font->atlas = atlas;
+	SDL_SetTextureBlendMode(font->atlas, SDL_BLENDMODE_BLEND);
+	font->atlas_height = height;
+	font->pack.height = height;
+	return SDL_TRUE;
+}
+
+/* Forgets every glyph placed in the atlas. Called when the atlas is full
+ * and cannot grow; glyphs still in use are rasterized again on their
+ * next use. */
+static void FOX_FlushGlyphs(FOX_Font *font) {
+	FOX_InitPacker(font, font->atlas_width, font->atlas_height);
+	for(int style = 0; style < FOX_STYLE_COUNT; style++) {
+		if(!font->state[style]) continue;
+		for(FT_Long i = 0; i < font->face->num_glyphs; i++) {
+			if(font->state[style][i] == FOX_GLYPH_LOADED) {
+				font->state[style][i] = FOX_GLYPH_UNLOADED;
+			}
+		}
+	}
+}
+
+/* Loads the glyph outline and synthesizes the requested style from it:
+ * bold by emboldening and italic by shearing the outline, the same way
+ * FreeType's FT_GlyphSlot_Embolden/FT_GlyphSlot_Oblique do. Only the
+ * horizontal stroke is widened so the glyph keeps its line height. */
+static FT_Error FOX_RenderStyledGlyph(FOX_Font *font, FT_UInt index,
+															int style
+) {
+	if(style == FOX_STYLE_NORMAL) {
+		return FT_Load_Glyph(font->face, index, FT_LOAD_RENDER);
+	}
+
+	FT_Error error = FT_Load_Glyph(font->face, index, FT_LOAD_NO_BITMAP);
+	if(error) return error;
+
+	FT_GlyphSlot slot = font->face->glyph;
+	if(slot->format == FT_GLYPH_FORMAT_OUTLINE) {
+		if(style & FOX_STYLE_BOLD) {
+			FT_Pos strength = FT_MulFix(font->face->units_per_EM,
+									font->face->size->metrics.y_scale) / 24;
+			FT_Outline_EmboldenXY(&slot->outline, strength, 0);
+		}
+		if(style & FOX_STYLE_ITALIC) {
+			FT_Matrix shear = {0x10000, 0x0366A, 0, 0x10000};
+			FT_Outline_Transform(&slot->outline, &shear);
+		}
+	}
+	return FT_Render_Glyph(slot, FT_RENDER_MODE_NORMAL);
+}
+
+/* Rasterizes a single glyph and uploads it into a free spot of the atlas */
+static const FOX_GlyphMetrics* FOX_LoadGlyph(FOX_Font *font, FT_UInt index,
+															int style
+) {
+	font->state[style][index] = FOX_GLYPH_UNAVAILABLE;
+	if(FOX_RenderStyledGlyph(font, index, style)) return NULL;
+
+	FT_Bitmap *bitmap = &font->face->glyph->bitmap;
+	if(bitmap->pixel_mode != ft_pixel_mode_grays) return NULL;
+
+	stbrp_rect rect = {0};
+	rect.w = bitmap->width ? bitmap->width + 1 : 0;
+	rect.h = bitmap->rows ? bitmap->rows + 1 : 0;
+	if(!font->nodes) return NULL;
+	stbrp_pack_rects(&font->pack, &rect, 1);
+	while(!rect.was_packed && FOX_GrowAtlas(font)) {
+		stbrp_pack_rects(&font->pack, &rect, 1);
+	}
+	if(!rect.was_packed) {
+		FOX_FlushGlyphs(font);
+		if(!font->nodes) return NULL;
+		stbrp_pack_rects(&font->pack, &rect, 1);
+		if(!rect.was_packed) return NULL;
+	}
+
+	int pixels = bitmap->width * bitmap->rows;
+	if(pixels > font->scratch_size) {
+		Uint32 *scratch = SDL_realloc(font->scratch, pixels * sizeof(Uint32));
+		if(!scratch) return NULL;
+		font->scratch = scratch;
+		font->scratch_size = pixels;
+	}
+	if(pixels > 0) {
+		/* RGBA32 is byte order R, G, B, A regardless of endianness */
+		Uint8 *dst = (Uint8*)font->scratch;
+		for(unsigned int y = 0; y < bitmap->rows; y++) {
+			for(unsigned int x = 0; x < bitmap->width; x++) {
+				dst[0] = dst[1] = dst[2] = 255;
+				dst[3] = bitmap->buffer[y * bitmap->pitch + x];
+				dst += 4;
+			}
+		}
+		SDL_Rect area = {rect.x, rect.y, bitmap->width, bitmap->rows};
+		SDL_UpdateTexture(font->atlas, &area, font->scratch,
+											bitmap->width * 4);
+	}
+
+	FOX_SetMetrics(font, style, index, rect.x, rect.y);
+	font->state[style][index] = FOX_GLYPH_LOADED;
+	return &font->metrics[style][index];
+}
+
+static const FOX_GlyphMetrics* FOX_GetGlyph(FOX_Font *font, FT_UInt index,
+															int style
+) {
+	if(!font->state[style]) {
+		/* first glyph in this style */
+		font->state[style] = SDL_calloc(font->face->num_glyphs, 1);
+		font->metrics[style] = SDL_calloc(font->face->num_glyphs,
+											sizeof(FOX_GlyphMetrics));
+		if(!font->state[style] || !font->metrics[style]) {
+			SDL_free(font->state[style]);
+			SDL_free(font->metrics[style]);
+			font->state[style] = NULL;
+			font->metrics[style] = NULL;
+			return NULL;
+		}
+	}
+
+	switch(font->state[style][index]) {
+		case FOX_GLYPH_LOADED:
+			return &font->metrics[style][index];
+		case FOX_GLYPH_UNLOADED:
+			return FOX_LoadGlyph(font, index, style);
+		default:
+			return NULL;
+	}
+}
+
+static SDL_bool FOX_GrowCache(FOX_Font *font) {
+	int capacity = font->cache_capacity ? font->cache_capacity * 2 : 256;
+	FOX_CacheEntry *cache = SDL_malloc(sizeof(*cache) * capacity);
+	if(!cache) return SDL_FALSE;
+
+	FOX_CacheEntry *old = font->cache;
+	int old_capacity = font->cache_capacity;
+	font->cache = cache;
+	font->cache_capacity = capacity;
+	FOX_ClearCache(font);
+
+	for(int i = 0; i < old_capacity; i++) {
+		if(old[i].ch == FOX_CACHE_EMPTY) continue;
+		Uint32 slot = (old[i].ch * 2654435761u) & (capacity - 1);
+		while(cache[slot].ch != FOX_CACHE_EMPTY) {
+			slot = (slot + 1) & (capacity - 1);
+		}
+		cache[slot] = old[i];
+		font->cache_count++;
+	}
+	SDL_free(old);
+	return SDL_TRUE;
+}
+
+/* Finds the font of the fallback chain that provides `ch`. The answer is
+ * memoized per codepoint, so the chain is searched at most once. */
+static FOX_Font* FOX_ResolveChar(FOX_Font *font, Uint32 ch, FT_UInt *index) {
+	if(font->cache_capacity) {
+		Uint32 mask = font->cache_capacity - 1;
+		for(Uint32 slot = (ch * 2654435761u) & mask;
+			font->cache[slot].ch != FOX_CACHE_EMPTY;
+			slot = (slot + 1) & mask
+		) {
+			if(font->cache[slot].ch == ch) {
+				*index = font->cache[slot].index;
+				return font->cache[slot].font;
+			}
+		}
+	}
+
+	FOX_Font *owner = NULL;
+	*index = FT_Get_Char_Index(font->face, ch);
+	if(*index != 0) {
+		owner = font;
+	} else {
+		for(int i = 0; i < font->num_fallbacks; i++) {
+			*index = FT_Get_Char_Index(font->fallbacks[i]->face, ch);
+			if(*index != 0) {
+				owner = font->fallbacks[i];
+				break;
+			}
+		}
+	}
+
+	/* keep the load factor at or below one half */
+	if(ch != FOX_CACHE_EMPTY && ((font->cache_count + 1) * 2 <=
+					font->cache_capacity || FOX_GrowCache(font))) {
+		Uint32 mask = font->cache_capacity - 1;
+		Uint32 slot = (ch * 2654435761u) & mask;
+		while(font->cache[slot].ch != FOX_CACHE_EMPTY) {
+			slot = (slot + 1) & mask;
+		}
+		font->cache[slot].ch = ch;
+		font->cache[slot].font = owner;
+		font->cache[slot].index = *index;
+		font->cache_count++;
+	}
+
+	return owner;
+}
+
+static const FOX_GlyphMetrics* FOX_FindGlyph(FOX_Font *font, Uint32 ch,
+												FOX_Font **owner
+) {
+	FT_UInt index;
+	FOX_Font *found = FOX_ResolveChar(font, ch, &index);
+	if(owner) *owner = found;
+	if(found && found->state[font->style] &&
+		found->state[font->style][index] == FOX_GLYPH_LOADED) {
+		font->glyph_hits++;
+	} else {
+		font->glyph_misses++;
+	}
+	return found ? FOX_GetGlyph(found, index, font->style) : NULL;
+}
+
+void FOX_GetGlyphCacheStats(FOX_Font *font, Uint32 *hits, Uint32 *misses) {
+	if(hits) *hits = font->glyph_hits;
+	if(misses) *misses = font->glyph_misses;
+}
+
+void FOX_ResetGlyphCacheStats(FOX_Font *font) {
+	font->glyph_hits = 0;
+	font->glyph_misses = 0;
+}
+
+void FOX_AddFallbackFont(FOX_Font *font, FOX_Font *fallback) {
+	FOX_Font **fallbacks = SDL_realloc(font->fallbacks,
+						sizeof(*fallbacks) * (font->num_fallbacks + 1));
+	if(!fallbacks) return;
+	fallbacks[font->num_fallbacks++] = fallback;
+	font->fallbacks = fallbacks;
+
+	/* previously missing codepoints may now resolve */
+	FOX_ClearCache(font);
 }
 
 /******************************************************************************
@@ -344,7 +854,8 @@ int FOX_RenderChar(FOX_Font *font, Uint32 ch, Uint32 previous_ch,
 										const SDL_Point *position
 ) {
 	int advance = 0;
-	const FOX_GlyphMetrics *metrics = FOX_QueryGlyphMetrics(font, ch);
+	FOX_Font *owner;
+	const FOX_GlyphMetrics *metrics = FOX_FindGlyph(font, ch, &owner);
 	if(metrics) {
 		SDL_Rect dstrect;
 		SDL_Color color;
@@ -361,8 +872,8 @@ int FOX_RenderChar(FOX_Font *font, Uint32 ch, Uint32 previous_ch,
 
 		SDL_GetRenderDrawColor(font->renderer, &color.r,
 							&color.g, &color.b, &color.a);
-		SDL_SetTextureColorMod(font->atlas, color.r, color.g, color.b);
-		SDL_RenderCopyEx(font->renderer, font->atlas, &metrics->rect,
+		SDL_SetTextureColorMod(owner->atlas, color.r, color.g, color.b);
+		SDL_RenderCopyEx(font->renderer, owner->atlas, &metrics->rect,
 								&dstrect, 0.0, NULL, SDL_FLIP_NONE);
 		advance += metrics->advance;
 	}
@@ -430,8 +941,8 @@ int FOX_RenderTextInside(FOX_Font *font, const Uint8 *text,
 }
 
 void FOX_RenderAtlas(FOX_Font *font, SDL_Point *pos) {
-	SDL_Rect dstrect = {pos->x, pos->y, font->length * font->size.ptsize,
-										font->length * font->size.ptsize};
+	SDL_Rect dstrect = {pos->x, pos->y, font->atlas_width,
+										font->atlas_height};
 	SDL_RenderCopy(font->renderer, font->atlas, NULL, &dstrect);
 }
 
@@ -440,13 +951,7 @@ void FOX_RenderAtlas(FOX_Font *font, SDL_Point *pos) {
  *****************************************************************************/
 
 const FOX_GlyphMetrics* FOX_QueryGlyphMetrics(FOX_Font *font, Uint32 ch) {
-	const FOX_GlyphMetrics *metrics = NULL;
-	FT_UInt glyph_index = FT_Get_Char_Index(font->face, ch);
-	if(glyph_index != 0) {
-		metrics = &font->metrics[glyph_index];
-	}
-
-	return metrics;
+	return FOX_FindGlyph(font, ch, NULL);
 }
 
 int FOX_GetKerningOffset(FOX_Font *font, Uint32 ch, Uint32 previous_ch) {
@@ -477,6 +982,14 @@ int FOX_GetAdvance(FOX_Font *font, Uint32 ch, Uint32 previous_ch) {
 	return advance;
 }
 
+void FOX_SetFontStyle(FOX_Font *font, int style) {
+	font->style = style & (FOX_STYLE_BOLD | FOX_STYLE_ITALIC);
+}
+
+int FOX_GetFontStyle(FOX_Font *font) {
+	return font->style;
+}
+
 void FOX_EnableKerning(FOX_Font *font, SDL_bool enable) {
 	font->use_kerning = enable && FT_HAS_KERNING(font->face);
 }
@@ -56,6 +56,18 @@ typedef struct FOX_Font FOX_Font;
 extern DECLSPEC FOX_Font* SDLCALL FOX_OpenFont(SDL_Renderer *renderer,
 										const char *path, int size);
 
+/* Flags for FOX_OpenFontEx */
+enum FOX_FontFlags {
+	FOX_FONT_DEFAULT = 0,
+	/* Rasterize glyphs into the atlas on first use instead of up front.
+	 * Meant for large fonts (i.e. CJK) used as fallbacks. */
+	FOX_FONT_LAZY = 1 << 0
+};
+
+/* Opens a font like FOX_OpenFont, with FOX_FontFlags. */
+extern DECLSPEC FOX_Font* SDLCALL FOX_OpenFontEx(SDL_Renderer *renderer,
+							const char *path, int size, Uint32 flags);
+
 /* build option to enable fontconfig */
 #ifdef FOX_USE_FONTCONFIG
 
@@ -68,6 +80,12 @@ extern DECLSPEC FOX_Font* SDLCALL FOX_OpenFontFc(SDL_Renderer *renderer,
 /* Closes a previously opened font via its handle. */
 extern DECLSPEC void SDLCALL FOX_CloseFont(FOX_Font *font);
 
+/* Appends a font that is searched, in order of addition, for characters
+ * missing from `font`. Which font provides a character is cached per
+ * codepoint. The fallback is not owned by `font` and must outlive it. */
+extern DECLSPEC void SDLCALL FOX_AddFallbackFont(FOX_Font *font,
+												FOX_Font *fallback);
+
 /******************************************************************************
  * Font rendering
  *****************************************************************************/
@@ -91,6 +109,13 @@ enum FOX_PrintState {
 extern DECLSPEC int SDLCALL FOX_RenderTextInside(FOX_Font *font,
 	const Uint8 *text, const Uint8 **endptr, const SDL_Rect *rect, int n);
 
+/* Counts glyph lookups of the render functions that were served from the
+ * atlas (hits) and those that had to rasterize or found nothing (misses),
+ * since the font was opened or the counters were reset. */
+extern DECLSPEC void SDLCALL FOX_GetGlyphCacheStats(FOX_Font *font,
+						Uint32 *hits, Uint32 *misses);
+extern DECLSPEC void SDLCALL FOX_ResetGlyphCacheStats(FOX_Font *font);
+
 /* Primarily for debugging purposes, this function renders the entire font
  * atlas at the given position. */
 extern DECLSPEC void SDLCALL FOX_RenderAtlas(FOX_Font *font, SDL_Point *pos);
@@ -118,6 +143,22 @@ extern DECLSPEC int SDLCALL FOX_GetKerningOffset(FOX_Font *font,
 extern DECLSPEC int SDLCALL FOX_GetAdvance(FOX_Font *font,
 							Uint32 ch, Uint32 previous_ch);
 
+/* Glyph styles synthesized from the font outlines */
+enum FOX_FontStyle {
+	FOX_STYLE_NORMAL = 0,
+	FOX_STYLE_BOLD = 1 << 0,	/* emboldened outline */
+	FOX_STYLE_ITALIC = 1 << 1	/* sheared outline */
+};
+
+/* Sets the style (a combination of FOX_FontStyle) used for rendering and
+ * glyph queries. Styled glyphs are rasterized on first use and share the
+ * atlas of the font, so only glyphs actually used in a style cost memory.
+ * Fallback fonts are rendered in the style of the font they belong to. */
+extern DECLSPEC void SDLCALL FOX_SetFontStyle(FOX_Font *font, int style);
+
+/* Gets the current style of the font. */
+extern DECLSPEC int SDLCALL FOX_GetFontStyle(FOX_Font *font);
+
 /* Enable/Disable kerning for the specified font. */
 extern DECLSPEC void SDLCALL FOX_EnableKerning(FOX_Font *font,
 												SDL_bool enable);